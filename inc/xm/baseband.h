@@ -0,0 +1,123 @@
+#ifndef XM_BASEBAND_H_
+#define XM_BASEBAND_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "vector.h"
+#include "halfband.h"
+
+namespace xm {
+
+    //
+    // Real to complex at half rate.  This tunes real samples down by fs/4,
+    // applies a halfband, and decimates by 2, all in one pass.  The fs/4
+    // tune multiplies sample n by (-j)**n, so the even samples stay real and
+    // the odd ones become imaginary, with the sign flipping every other
+    // sample.  Since the halfband only has a center tap and odd taps, the
+    // real part of output m is just the center sample, and the imaginary
+    // part is a real FIR over the odd samples with the alternating signs
+    // folded into the taps:
+    //
+    //     y[m] = (-1)**m * (x[2m]/2 + j*sum over k of g[k]*x[2m - span + 2k])
+    //
+    // So the mixing costs no multiplies, and the FIR does four outputs per
+    // f32x4 against a broadcast tap.  The tuning phase is relative to the
+    // absolute sample, so output m is centered on input 2*m.
+    //
+    struct baseband {
+        //~baseband() = default;
+        //baseband() = default;
+        //baseband(const baseband&) = default;
+        //baseband& operator =(const baseband&) = default;
+
+        // percent of the output band to preserve
+        inline baseband(int window, double percent);
+
+        // The number of inputs before (and after) an output's center
+        inline int64 margin() const;
+
+        // Input needed for len outputs: src[0] is input sample 2*off - margin()
+        inline int64 needed(int64 len) const;
+
+        // Computes outputs [off, off + len) from real samples of any type
+        template<class type>
+        void apply(cfloat* dst, int64 off, int64 len, const type* src);
+
+        private:
+            int64 span;
+            vector<float> taps;  // signed odd taps, each broadcast 4 times
+            vector<float> odd;   // the odd samples, converted to float
+    };
+
+    baseband::baseband(int window, double percent) {
+        check(percent > 0 && percent < 100, "percent must be in (0, 100)");
+        vector<double> odds = halfodds(window, .5 - percent*.005);
+        span = odds.size() - 1;
+        // odd sample 2m - span + 2k is imaginary with sign
+        // -(-1)**(m + k - (span + 1)/2) after the tune
+        taps.resize(4*odds.size());
+        for (int64 kk = 0; kk<odds.size(); kk++) {
+            double sign = (kk - (span + 1)/2)%2 ? +1 : -1;
+            for (int64 ii = 0; ii<4; ii++) {
+                taps[4*kk + ii] = sign*odds[kk];
+            }
+        }
+    }
+
+    int64 baseband::margin() const {
+        return span;
+    }
+
+    int64 baseband::needed(int64 len) const {
+        if (len <= 0) return 0;
+        return 2*(len - 1) + 2*span + 1;
+    }
+
+    template<class type>
+    void baseband::apply(cfloat* dst, int64 off, int64 len, const type* src) {
+        const int64 width = span + 1;
+        const int64 count = len + span;
+        if (odd.size() < count + 4) odd.resize(count + 4);
+
+        float* oo = odd.data();
+        for (int64 ii = 0; ii<count; ii++) {
+            oo[ii] = src[2*ii];
+        }
+
+        const float* gg = taps.data();
+        int64 mm = 0;
+        for (; mm + 8 <= len; mm += 8) {
+            f32x4 acc0 = { 0, 0, 0, 0 };
+            f32x4 acc1 = { 0, 0, 0, 0 };
+            for (int64 kk = 0; kk<width; kk++) {
+                f32x4 tap = simdload<f32x4>(gg + 4*kk);
+                acc0 += simdload<f32x4>(oo + mm + kk + 0)*tap;
+                acc1 += simdload<f32x4>(oo + mm + kk + 4)*tap;
+            }
+            for (int64 ii = 0; ii<4; ii++) {
+                dst[mm + ii + 0].im = acc0[ii];
+                dst[mm + ii + 4].im = acc1[ii];
+            }
+        }
+        for (; mm < len; mm++) {
+            float acc = 0;
+            for (int64 kk = 0; kk<width; kk++) {
+                acc += oo[mm + kk]*gg[4*kk];
+            }
+            dst[mm].im = acc;
+        }
+
+        // the center samples, then the sign of the tune
+        for (mm = 0; mm<len; mm++) {
+            dst[mm].re = .5f*src[span + 2*mm];
+            if ((off + mm)%2) dst[mm] = -dst[mm];
+        }
+    }
+
+}
+
+#endif // XM_BASEBAND_H_
+
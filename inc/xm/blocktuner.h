@@ -6,6 +6,7 @@
 
 #include "basics.h"
 #include "complex.h"
+#include "simd.h"
 
 namespace xm {
 
@@ -13,6 +14,12 @@ namespace xm {
     // precision than a 64 bit double, and it does not lose accuracy as the
     // sequence of data gets large.  A block of 1024 precomputed phasors is
     // stored so there are no trig calls in the inner loop of the apply method.
+    //
+    // The block is stored pre-split for SIMD, with the real parts duplicated
+    // (re0, re0, re1, re1) and the sign folded into the imaginary parts (-im0,
+    // im0, -im1, im1).  The phasor for the start of each chunk is broadcast
+    // into registers, so the inner loop does two samples at a time without
+    // any shuffling of the block or memory traffic beyond the data.
     struct blocktuner {
         //~blocktuner() = default;
         //blocktuner() = default;
@@ -27,9 +34,18 @@ namespace xm {
         // the tuned data stream.  len is the number of samples
         inline void apply(cfloat* ptr, int64 off, int64 len);
 
+        // Converts and tunes in one pass, for instance straight from the
+        // CB or CI samples in a file.  Each chunk is converted into dst and
+        // tuned while it's still in cache.  Byte swapping is up to the caller.
+        template<class type>
+        void apply(cfloat* dst, const complex<type>* src, int64 off, int64 len);
+
         private:
-            cfloat block[1024];
+            float blockre[2048];
+            float blockim[2048];
             uint64_t delta;
+
+            inline void tune(float* ptr, uint64_t phase, int64 amt) const;
     };
 
 
@@ -40,7 +56,37 @@ namespace xm {
         for (uint64_t ii = 0; ii<1024; ii++) {
             uint64_t phase = delta * ii;
             double angle = 2*M_PI*(phase0 + phase*pow(2.0, -64));
-            block[ii] = cfloat(cos(angle), sin(angle));
+            blockre[2*ii + 0] = cos(angle);
+            blockre[2*ii + 1] = cos(angle);
+            blockim[2*ii + 0] = -sin(angle);
+            blockim[2*ii + 1] = sin(angle);
+        }
+    }
+
+    void blocktuner::tune(float* ptr, uint64_t phase, int64 amt) const {
+        double angle = 2*M_PI*phase*pow(2.0, -64);
+        const float cc = cos(angle);
+        const float ss = sin(angle);
+        const f32x4 extre = { cc, cc, cc, cc };
+        const f32x4 extim = { -ss, ss, -ss, ss };
+        const i32x4 flip = { 1, 0, 3, 2 };
+
+        int64 ii = 0;
+        for (; ii + 2 <= amt; ii += 2) {
+            f32x4 xx = simdload<f32x4>(ptr + 2*ii);
+            f32x4 yy = (
+                xx*simdload<f32x4>(blockre + 2*ii) +
+                __builtin_shuffle(xx, flip)*simdload<f32x4>(blockim + 2*ii)
+            );
+            simdstore(ptr + 2*ii, yy*extre + __builtin_shuffle(yy, flip)*extim);
+        }
+        for (; ii < amt; ii++) {
+            float re = ptr[2*ii + 0];
+            float im = ptr[2*ii + 1];
+            float tr = re*blockre[2*ii] + im*blockim[2*ii + 0];
+            float ti = im*blockre[2*ii] + re*blockim[2*ii + 1];
+            ptr[2*ii + 0] = tr*cc - ti*ss;
+            ptr[2*ii + 1] = ti*cc + tr*ss;
         }
     }
 
@@ -48,17 +94,34 @@ namespace xm {
         // this assumes 2's complement, which should always be true
         uint64_t phase = delta*(uint64_t)off;
         while (len > 0) {
-            double angle = 2*M_PI*phase*pow(2.0, -64);
-            cfloat extra = cfloat(cos(angle), sin(angle));
+            int64 amt = len;
+            if (amt > 1024) amt = 1024;
 
-            uint64_t amt = len;
+            tune((float*)ptr, phase, amt);
+
+            len -= amt;
+            ptr += amt;
+            phase += amt*delta;
+        }
+    }
+
+    template<class type>
+    void blocktuner::apply(cfloat* dst, const complex<type>* src, int64 off, int64 len) {
+        uint64_t phase = delta*(uint64_t)off;
+        while (len > 0) {
+            int64 amt = len;
             if (amt > 1024) amt = 1024;
-            for (uint64_t ii = 0; ii<amt; ii++) {
-                ptr[ii] = ptr[ii] * block[ii] * extra;
+
+            float* ptr = (float*)dst;
+            const type* raw = (const type*)src;
+            for (int64 ii = 0; ii<2*amt; ii++) {
+                ptr[ii] = raw[ii];
             }
+            tune(ptr, phase, amt);
 
             len -= amt;
-            ptr += amt;
+            src += amt;
+            dst += amt;
             phase += amt*delta;
         }
     }
@@ -969,6 +969,116 @@ namespace xm {
 
     }
 
+    namespace internal {
+        // Converts length samples in the raw format to cfloat.  Byte
+        // swapping is done in place, so the raw buffer gets modified.
+        static inline void convertcf(
+            const string& format, bool swapped, void* raw, cfloat* samples, int64 length
+        ) {
+            if (format == "CF") {
+                float* ptr = (float*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<2*length; ii++) {
+                        byteswap4(ptr + ii);
+                    }
+                }
+                memcpy((void*)samples, ptr, length*sizeof(cfloat));
+
+            } else if (format == "SB") {
+                int8_t* ptr = (int8_t*)raw;
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[ii], 0);
+                }
+
+            } else if (format == "SI") {
+                int16_t* ptr = (int16_t*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<length; ii++) {
+                        byteswap2(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[ii], 0);
+                }
+
+            } else if (format == "SL") {
+                int32_t* ptr = (int32_t*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<length; ii++) {
+                        byteswap4(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[ii], 0);
+                }
+
+            } else if (format == "SF") {
+                float* ptr = (float*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<length; ii++) {
+                        byteswap4(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[ii], 0);
+                }
+
+            } else if (format == "SD") {
+                double* ptr = (double*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<length; ii++) {
+                        byteswap8(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[ii], 0);
+                }
+
+            } else if (format == "CB") {
+                int8_t* ptr = (int8_t*)raw;
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
+                }
+
+            } else if (format == "CI") {
+                int16_t* ptr = (int16_t*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<2*length; ii++) {
+                        byteswap2(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
+                }
+
+            } else if (format == "CL") {
+                int32_t* ptr = (int32_t*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<2*length; ii++) {
+                        byteswap4(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
+                }
+
+            } else if (format == "CD") {
+                double* ptr = (double*)raw;
+                if (swapped) {
+                    for (int64 ii = 0; ii<2*length; ii++) {
+                        byteswap8(ptr + ii);
+                    }
+                }
+                for (int64 ii = 0; ii<length; ii++) {
+                    samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
+                }
+
+            } else {
+                check(false, "unsuported conversion '%s' to 'CF'", format.data());
+            }
+        }
+    }
+
     //}}}
     //{{{ bluereader
 
@@ -982,6 +1092,7 @@ namespace xm {
 
         inline bool kwds_ready() const;
         inline bool is_swapped() const;
+        inline bool is_file() const;
 
         inline const bluemeta* operator ->() const;
         inline const bluemeta& operator *() const;
@@ -992,6 +1103,12 @@ namespace xm {
         // this grab function will do conversion and byteswapping
         inline void grabcf(int64 offset, cfloat* data, int64 length);
 
+        // Reads columns [col, col + cols) of rows [row, row + rows) from a
+        // Type 2000 file, converting to cfloat.  For regular files this goes
+        // through mmap, so only the pages holding those columns are touched,
+        // and it may be called in any order.  Pipes fall back to grabcf.
+        inline void grabcols(int64 row, int64 rows, int64 col, int64 cols, cfloat* data);
+
         inline const void* mmap();
 
         inline int64 byte_offset(int64 sample);
@@ -1009,6 +1126,7 @@ namespace xm {
                 vector<char> scratch;
                 bool is_swapped;
                 bool kwds_ready;
+                int advice;
             };
             shared<implementation*> pimpl;
     };
@@ -1096,6 +1214,7 @@ namespace xm {
         pimpl.value()->cache_length  = 0;
         pimpl.value()->is_swapped    = memcmp(hdr.data_rep, xmnative, 4) != 0;
         pimpl.value()->kwds_ready    = kwds_ready;
+        pimpl.value()->advice        = -1;
 
         switch (hdr.type/1000) {
             case 1:
@@ -1198,6 +1317,12 @@ namespace xm {
         return pimpl.value()->is_swapped;
     }
 
+    // True for regular files, which can be mmap'd, and false for pipes
+    bool bluereader::is_file() const {
+        check(pimpl.valid(), "need an opened file");
+        return pimpl.value()->file.isfile();
+    }
+
     const bluemeta* bluereader::operator ->() const {
         check(pimpl.valid(), "need an opened file");
         return &pimpl.value()->meta;
@@ -1310,98 +1435,53 @@ namespace xm {
         // the rest perform type conversions and use the scratch buffer
         pimpl.value()->scratch.resize(length * sample_size);
         grab(offset*sample_size, (char*)pimpl.value()->scratch.data(), length*sample_size);
+        convertcf(
+            pimpl.value()->meta.format, pimpl.value()->is_swapped,
+            pimpl.value()->scratch.data(), samples, length
+        );
+    }
 
-        if (pimpl.value()->meta.format == "SB") {
-            int8_t* ptr = (int8_t*)pimpl.value()->scratch.data();
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[ii], 0);
-            }
-
-        } else if (pimpl.value()->meta.format == "SI") {
-            int16_t* ptr = (int16_t*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<length; ii++) {
-                    byteswap2(ptr + ii);
-                }
-            }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[ii], 0);
-            }
-
-        } else if (pimpl.value()->meta.format == "SL") {
-            int32_t* ptr = (int32_t*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<length; ii++) {
-                    byteswap4(ptr + ii);
-                }
-            }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[ii], 0);
-            }
-
-        } else if (pimpl.value()->meta.format == "SF") {
-            float* ptr = (float*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<length; ii++) {
-                    byteswap4(ptr + ii);
-                }
-            }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[ii], 0);
-            }
-
-        } else if (pimpl.value()->meta.format == "SD") {
-            double* ptr = (double*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<length; ii++) {
-                    byteswap8(ptr + ii);
-                }
-            }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[ii], 0);
-            }
-
-        } else if (pimpl.value()->meta.format == "CB") {
-            int8_t* ptr = (int8_t*)pimpl.value()->scratch.data();
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
-            }
+    void bluereader::grabcols(int64 row, int64 rows, int64 col, int64 cols, cfloat* data) {
+        using namespace internal;
+        check(pimpl.valid(), "need an opened file");
+        const bluemeta& meta = pimpl.value()->meta;
+        check(meta.type/1000 == 2, "must be Type 2000 file");
+        check(col >= 0 && cols >= 0 && col + cols <= meta.xcount,
+            "columns [%lld, %lld) out of range", col, col + cols
+        );
 
-        } else if (pimpl.value()->meta.format == "CI") {
-            int16_t* ptr = (int16_t*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<2*length; ii++) {
-                    byteswap2(ptr + ii);
-                }
-            }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
+        if (!pimpl.value()->file.isfile()) {
+            for (int64 ii = 0; ii<rows; ii++) {
+                grabcf((row + ii)*meta.xcount + col, data + ii*cols, cols);
             }
+            return;
+        }
 
-        } else if (pimpl.value()->meta.format == "CL") {
-            int32_t* ptr = (int32_t*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<2*length; ii++) {
-                    byteswap4(ptr + ii);
-                }
-            }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
-            }
+        const int64 itemsize = meta.itemsize;
+        const int64 rowbytes = meta.xcount*itemsize;
+        const int64 colbytes = cols*itemsize;
+        const char* base = (const char*)mmap();
+
+        // Tell the kernel not to read ahead when we only want a sliver of
+        // each row, otherwise it would pull in the whole file anyway.
+        int advice = 4*colbytes < rowbytes ? MADV_RANDOM : MADV_SEQUENTIAL;
+        if (advice != pimpl.value()->advice) {
+            const void* start = pimpl.value()->file.mmap();
+            int64 length = pimpl.value()->data_offset + pimpl.value()->data_length;
+            madvise((void*)start, length, advice);
+            pimpl.value()->advice = advice;
+        }
 
-        } else if (pimpl.value()->meta.format == "CD") {
-            double* ptr = (double*)pimpl.value()->scratch.data();
-            if (pimpl.value()->is_swapped) {
-                for (int64 ii = 0; ii<2*length; ii++) {
-                    byteswap8(ptr + ii);
-                }
+        pimpl.value()->scratch.resize(colbytes);
+        char* raw = pimpl.value()->scratch.data();
+        for (int64 ii = 0; ii<rows; ii++) {
+            int64 rr = row + ii;
+            if (rr < 0 || rr >= meta.ycount) {
+                memset((void*)(data + ii*cols), 0, cols*sizeof(cfloat));
+                continue;
             }
-            for (int64 ii = 0; ii<length; ii++) {
-                samples[ii] = cfloat(ptr[2*ii + 0], ptr[2*ii + 1]);
-            }
-
-        } else {
-            check(false, "unsuported conversion '%s' to 'CF'", pimpl.value()->meta.format.data());
+            memcpy(raw, base + rr*rowbytes + col*itemsize, colbytes);
+            convertcf(meta.format, pimpl.value()->is_swapped, raw, data + ii*cols, cols);
         }
     }
 
@@ -0,0 +1,219 @@
+#ifndef XM_CAF_H_
+#define XM_CAF_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "vector.h"
+#include "parallel.h"
+#include "kissfft.h"
+#include "blocktuner.h"
+
+namespace xm {
+
+    namespace internal {
+        struct cafbatch;
+        struct cafrows;
+    }
+
+    //
+    // Complex ambiguity function of a reference s1 against an input s2:
+    //
+    //     caf(lag, dfreq) = sum over n of
+    //         conj(s1[n])*s2[n + lag]*exp(-2j*pi*dfreq*(n + lag))
+    //
+    // Each Doppler row is the cross correlation of s1 with s2 tuned by
+    // -dfreq, done with FFTs big enough that no lags wrap around.  Tuning by
+    // a whole FFT bin is just a circular shift of the spectrum, so the
+    // Doppler grid is split into batches that share a sub-bin tune.  Each
+    // batch tunes s2 with a blocktuner and does its forward FFT once up
+    // front, and after that every row is a shifted multiply against the
+    // reference spectrum and one inverse FFT.  Rows are spread over a
+    // threadpool.
+    //
+    // The Doppler step is 1/(fftsize*oversample) cycles per sample, and the
+    // magnitudes are divided by the norms of both signals, so a perfect
+    // match at one lag and Doppler comes out as 1.
+    //
+    struct caf {
+        //~caf() = default;
+        //caf(const caf&) = default;
+        //caf& operator =(const caf&) = default;
+
+        // The signals are copied, so they can be freed after this.  There
+        // are oversample sub-bin tunes per FFT bin.
+        inline caf(
+            const cfloat* s1, int64 n1, const cfloat* s2, int64 n2,
+            int64 oversample, threadpool& pool
+        );
+
+        // Writes |caf| for Doppler indices [doppler, doppler + rows) and
+        // lags [lag, lag + cols) to dst, one row after another.  Doppler
+        // index jj is jj/(fftsize()*oversample()) cycles per sample and can
+        // be negative.  Lags outside of [1 - n1, n2) have no overlap and
+        // come out as zero.
+        inline void surface(
+            float* dst, int64 doppler, int64 rows,
+            int64 lag, int64 cols, threadpool& pool
+        ) const;
+
+        inline int64 fftsize() const;
+        inline int64 oversample() const;
+
+        private:
+            friend struct internal::cafbatch;
+            friend struct internal::cafrows;
+            int64 fsize;
+            int64 over;
+            int64 lo, hi;             // lags with any overlap, [lo, hi)
+            float scale;              // 1/(fsize*norm(s1)*norm(s2))
+            kissfft<float> forward;
+            kissfft<float> inverse;
+            vector<cfloat> reference; // conj(FFT(s1))
+            vector<cfloat> batches;   // FFT(s2) for each sub-bin tune
+    };
+
+    namespace internal {
+
+        // One sub-bin tune of s2 per index
+        struct cafbatch {
+            const caf* self;
+            const cfloat* s2;
+            int64 n2, first;
+            cfloat* work;   // fsize + scratch per index
+            cfloat* batches;
+
+            void operator ()(int64 index) {
+                const int64 fsize = self->fsize;
+                const int64 tune = first + index;
+                cfloat* buffer = work + index*(fsize + self->forward.scratch_size());
+                for (int64 ii = 0; ii<n2; ii++) buffer[ii] = s2[ii];
+                for (int64 ii = n2; ii<fsize; ii++) buffer[ii] = cfloat(0, 0);
+                if (tune != 0) {
+                    blocktuner tuner(-tune/(double)(fsize*self->over));
+                    tuner.apply(buffer, 0, n2);
+                }
+                self->forward.exec(batches + tune*fsize, buffer, buffer + fsize);
+            }
+        };
+
+        // Each index is one share of the rows with its own scratch space
+        struct cafrows {
+            const caf* self;
+            float* dst;
+            int64 doppler, rows, share, lag, cols;
+            cfloat* work;   // fsize + scratch per index
+
+            void operator ()(int64 index) {
+                const int64 fsize = self->fsize;
+                const int64 over = self->over;
+                cfloat* freq = work + index*(fsize + self->inverse.scratch_size());
+                const cfloat* ref = self->reference.data();
+
+                const int64 end = min(rows, (index + 1)*share);
+                for (int64 rr = index*share; rr<end; rr++) {
+                    // split the Doppler into whole bins and a sub-bin tune
+                    const int64 jj = doppler + rr;
+                    const int64 bins = jj >= 0 ? jj/over : -((over - 1 - jj)/over);
+                    const int64 sub = jj - bins*over;
+                    int64 shift = bins%fsize;
+                    if (shift < 0) shift += fsize;
+
+                    const cfloat* tuned = self->batches.data() + sub*fsize;
+                    for (int64 kk = 0; kk<fsize - shift; kk++) {
+                        freq[kk] = ref[kk]*tuned[kk + shift];
+                    }
+                    for (int64 kk = fsize - shift; kk<fsize; kk++) {
+                        freq[kk] = ref[kk]*tuned[kk + shift - fsize];
+                    }
+                    self->inverse.exec(freq, freq, freq + fsize);
+
+                    float* out = dst + rr*cols;
+                    for (int64 cc = 0; cc<cols; cc++) {
+                        const int64 tau = lag + cc;
+                        if (tau < self->lo || tau >= self->hi) {
+                            out[cc] = 0;
+                            continue;
+                        }
+                        out[cc] = mag(freq[tau < 0 ? tau + fsize : tau])*self->scale;
+                    }
+                }
+            }
+        };
+
+    }
+
+    caf::caf(
+        const cfloat* s1, int64 n1, const cfloat* s2, int64 n2,
+        int64 oversample, threadpool& pool
+    ) : over(oversample), lo(1 - n1), hi(n2), forward(0), inverse(0) {
+        check(n1 >= 1 && n2 >= 1, "need non-empty signals");
+        check(oversample >= 1, "need positive oversample (%lld)", oversample);
+
+        fsize = 1;
+        while (fsize < n1 + n2 - 1) fsize *= 2;
+        forward = kissfft<float>(fsize);
+        inverse = kissfft<float>(fsize, true);
+
+        double norm1 = 0, norm2 = 0;
+        reference.resize(fsize, cfloat(0, 0));
+        for (int64 ii = 0; ii<n1; ii++) {
+            reference[ii] = s1[ii];
+            norm1 += mag2(s1[ii]);
+        }
+        for (int64 ii = 0; ii<n2; ii++) {
+            norm2 += mag2(s2[ii]);
+        }
+        scale = norm1*norm2 > 0 ? 1/(fsize*sqrt(norm1*norm2)) : 0;
+        forward.exec(reference.data(), reference.data());
+        for (int64 kk = 0; kk<fsize; kk++) {
+            reference[kk] = conj(reference[kk]);
+        }
+
+        batches.resize(over*fsize);
+        vector<cfloat> work(pool.size()*(fsize + forward.scratch_size()));
+        internal::cafbatch func;
+        func.self = this;
+        func.s2 = s2;
+        func.n2 = n2;
+        func.work = work.data();
+        func.batches = batches.data();
+        // no more indices than threads, since each one has its own scratch
+        for (int64 ii = 0; ii<over; ii += pool.size()) {
+            func.first = ii;
+            pool.parfor(min(pool.size(), over - ii), func);
+        }
+    }
+
+    void caf::surface(
+        float* dst, int64 doppler, int64 rows,
+        int64 lag, int64 cols, threadpool& pool
+    ) const {
+        if (rows <= 0 || cols <= 0) return;
+        const int64 shares = min(pool.size(), rows);
+        vector<cfloat> work(shares*(fsize + inverse.scratch_size()));
+        internal::cafrows func;
+        func.self = this;
+        func.dst = dst;
+        func.doppler = doppler;
+        func.rows = rows;
+        func.share = (rows + shares - 1)/shares;
+        func.lag = lag;
+        func.cols = cols;
+        func.work = work.data();
+        pool.parfor(shares, func);
+    }
+
+    int64 caf::fftsize() const {
+        return fsize;
+    }
+
+    int64 caf::oversample() const {
+        return over;
+    }
+
+}
+
+#endif // XM_CAF_H_
+
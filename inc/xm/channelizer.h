@@ -0,0 +1,152 @@
+#ifndef XM_CHANNELIZER_H_
+#define XM_CHANNELIZER_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "vector.h"
+#include "firwin.h"
+#include "kissfft.h"
+
+namespace xm {
+
+    //
+    // Polyphase FFT channelizer.  This splits the input into channels evenly
+    // spaced by 1/channels (cycles per sample), where channel k is the same
+    // as tuning by -k/channels, lowpass filtering, and keeping every decim'th
+    // sample.  Doing that for every channel costs channels*taps per output,
+    // but the tunings are the columns of a DFT, so all of the channels come
+    // from one weighted sum over the input and one inverse FFT per row:
+    //
+    //     a[i] = sum over p of h[p*channels + i]*x[...]
+    //     y[k] = sum over q of a[...]*exp(+2 pi j k q/channels)
+    //
+    // That's taps + channels*log(channels) per row, or about taps/decim +
+    // log(channels) per input sample when decim is channels (critically
+    // sampled) or channels/2 (2x oversampled).  The tuning phase is relative
+    // to the absolute input sample, so any decim is allowed and the rows are
+    // continuous in phase just like blocktuner.
+    //
+    // Row m is centered on input sample m*decim.  The columns are in FFT
+    // order (channel k at k/channels), so use hshift to center them.
+    //
+    // The FFT keeps scratch space, so use one copy of this per thread.
+    //
+    struct channelizer {
+        //~channelizer() = default;
+        //channelizer() = default;
+        //channelizer(const channelizer&) = default;
+        //channelizer& operator =(const channelizer&) = default;
+
+        // The prototype lowpass keeps dwidth (fraction of the input rate)
+        // and has branch*channels taps, using the windows from firwin.
+        inline channelizer(
+            int64 channels, int64 decim, int window, double dwidth, int64 branch
+        );
+
+        // The number of inputs before a row's center
+        inline int64 margin() const;
+
+        // Input needed for len rows: src[0] is input sample off*decim - margin()
+        inline int64 needed(int64 len) const;
+
+        // Computes rows [off, off + len), each with channels outputs
+        inline void apply(cfloat* dst, int64 off, int64 len, const cfloat* src);
+
+        private:
+            int64 chans;
+            int64 decim;
+            int64 taps;
+            // prototype taps in input order, with each one duplicated
+            // for the real and imaginary parts of the samples
+            vector<float> proto;
+            vector<float> accum;
+            vector<cfloat> folded;
+            kissfft<float> fft;
+
+            inline void row(cfloat* dst, int64 index, const float* src);
+    };
+
+    channelizer::channelizer(
+        int64 channels, int64 decim, int window, double dwidth, int64 branch
+    ) : chans(channels), decim(decim), taps(channels*branch),
+        fft(channels, true) {
+        check(channels >= 1, "need positive channels (%lld)", channels);
+        check(decim >= 1, "need positive decimation (%lld)", decim);
+        check(branch >= 1, "need positive taps per branch (%lld)", branch);
+
+        // tap ii multiplies input sample m*decim - margin() + ii, and the
+        // window is zero at the first tap, so the response is symmetric
+        const int64 center = taps/2;
+        vector<double> lowpass(taps);
+        double sum = 0.0;
+        for (int64 ii = 0; ii<taps; ii++) {
+            double xx = ii - center;
+            lowpass[ii] = firwin(window, xx, taps)*sinc(xx*dwidth);
+            sum += lowpass[ii];
+        }
+
+        proto.resize(2*taps);
+        for (int64 ii = 0; ii<taps; ii++) {
+            proto[2*ii + 0] = lowpass[ii]/sum;
+            proto[2*ii + 1] = lowpass[ii]/sum;
+        }
+        accum.resize(2*chans);
+        folded.resize(chans);
+    }
+
+    int64 channelizer::margin() const {
+        return taps - 1 - taps/2;
+    }
+
+    int64 channelizer::needed(int64 len) const {
+        if (len <= 0) return 0;
+        return (len - 1)*decim + taps;
+    }
+
+    void channelizer::row(cfloat* dst, int64 index, const float* src) {
+        // weight the input and fold it into one stripe of channels samples
+        float* acc = accum.data();
+        const float* hh = proto.data();
+        const int64 width = 2*chans;
+        for (int64 ii = 0; ii<width; ii++) acc[ii] = 0;
+        for (int64 pp = 0; pp<taps; pp += chans) {
+            const float* xx = src + 2*pp;
+            const float* ww = hh + 2*pp;
+            int64 ii = 0;
+            for (; ii + 4 <= width; ii += 4) {
+                simdstore(acc + ii,
+                    simdload<f32x4>(acc + ii) +
+                    simdload<f32x4>(xx + ii)*simdload<f32x4>(ww + ii)
+                );
+            }
+            for (; ii < width; ii++) {
+                acc[ii] += xx[ii]*ww[ii];
+            }
+        }
+
+        // Input sample n + center - rr is at acc[chans - 1 - rr], and its
+        // tuning phase is -k*(n + center - rr)/chans.  Rotating by the
+        // center's phase lines the folded samples up with an inverse FFT.
+        const int64 shift = (index*decim + taps/2)%chans;
+        cfloat* vv = folded.data();
+        for (int64 qq = 0; qq<chans; qq++) {
+            int64 rr = qq + shift;
+            if (rr >= chans) rr -= chans;
+            vv[qq] = cfloat(acc[2*(chans - 1 - rr) + 0], acc[2*(chans - 1 - rr) + 1]);
+        }
+        fft.exec(dst, vv);
+    }
+
+    void channelizer::apply(cfloat* dst, int64 off, int64 len, const cfloat* src) {
+        for (int64 ii = 0; ii<len; ii++) {
+            row(dst + ii*chans, off + ii, (const float*)(src + ii*decim));
+        }
+    }
+
+}
+
+#endif // XM_CHANNELIZER_H_
+
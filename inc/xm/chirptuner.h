@@ -0,0 +1,264 @@
+#ifndef XM_CHIRPTUNER_H_
+#define XM_CHIRPTUNER_H_ 1
+
+#include <math.h>
+#include <stdint.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "list.h"
+#include "vector.h"
+
+namespace xm {
+
+    // One piece of a frequency profile.  The frequency is linear within
+    // the segment, starting at dfreq (cycles per sample) at sample start
+    // and changing by drate (cycles per sample per sample) each sample.
+    struct chirpsegment {
+        int64 start;
+        double dfreq;
+        double drate;
+    };
+
+    // chirptuner extends the integer phase used by blocktuner with an
+    // integer frequency rate.  Phase, frequency, and rate are all fixed point
+    // with 64 fractional bits, and the phase at any sample is evaluated in
+    // closed form with wrap-around integer arithmetic:
+    //
+    //     phase(n) = phase0 + freq*n + rate*n*(n - 1)/2     (mod 2**64)
+    //
+    // So the phase is exact (for the quantized frequency and rate) no matter
+    // how far into the stream we are, and segments of a piecewise profile
+    // join with exactly continuous phase.
+    //
+    // Within a chunk of 1024 samples starting at n0, the phase splits into
+    // phase(n0) + freq(n0)*k + rate*k*(k - 1)/2.  The last term is the same
+    // for every chunk, so it's a precomputed table.  The linear term is
+    // factored with k = 32*a + b into two tables of 32 phasors, so there
+    // are 64 trig calls per 1024 samples, and none in the inner loop.
+    struct chirptuner {
+        //~chirptuner() = default;
+        //chirptuner() = default;
+        //chirptuner(const chirptuner&) = default;
+        //chirptuner& operator =(const chirptuner&) = default;
+
+        // Constant chirp from sample zero.  Arguments are the digital
+        // frequency at the first sample (cycles per sample), the rate
+        // (cycles per sample per sample), and phase at the first sample.
+        inline chirptuner(double dfreq, double drate, double phase0=0.0);
+
+        // Piecewise linear frequency profile.  Segments must be in order of
+        // increasing start.  The first segment also covers any samples
+        // before its start, and the last one continues forever.
+        inline chirptuner(const list<chirpsegment>& profile, double phase0=0.0);
+
+        // off - indicates the absolute offset where ptr is in
+        // the tuned data stream.  len is the number of samples
+        inline void apply(cfloat* ptr, int64 off, int64 len);
+
+        // Converts and tunes in one pass (see blocktuner)
+        template<class type>
+        void apply(cfloat* dst, const complex<type>* src, int64 off, int64 len);
+
+        // Exact phase and frequency at a sample, scaled by 2**64
+        inline uint64_t phase(int64 sample) const;
+        inline uint64_t freq(int64 sample) const;
+
+        private:
+            struct segment {
+                int64 start;
+                uint64_t phase;
+                uint64_t freq;
+                uint64_t rate;
+                // the quadratic part for 1024 samples, pre-split for SIMD
+                // the same way as in blocktuner
+                vector<float> chirpre;
+                vector<float> chirpim;
+            };
+            list<segment> segments;
+
+            static inline uint64_t fixed(double cycles);
+            static inline uint64_t triangle(int64 nn);
+            inline void build(const list<chirpsegment>& profile, double phase0);
+            inline int64 locate(int64 sample) const;
+            inline void tune(float* ptr, const segment& seg, int64 off, int64 amt) const;
+    };
+
+    chirptuner::chirptuner(double dfreq, double drate, double phase0) {
+        list<chirpsegment> profile;
+        chirpsegment seg = { 0, dfreq, drate };
+        profile.append(seg);
+        build(profile, phase0);
+    }
+
+    chirptuner::chirptuner(const list<chirpsegment>& profile, double phase0) {
+        build(profile, phase0);
+    }
+
+    uint64_t chirptuner::fixed(double cycles) {
+        // wrap to [-.5, .5) so negative rates are two's complement
+        long double scaled = (cycles - roundl(cycles))*powl(2.0, +64);
+        if (scaled >= powl(2.0, +63)) scaled -= powl(2.0, +64);
+        return (uint64_t)(int64_t)llroundl(scaled);
+    }
+
+    uint64_t chirptuner::triangle(int64 nn) {
+        // nn*(nn - 1)/2 modulo 2**64, dividing out the even factor first
+        // this assumes 2's complement, which should always be true
+        if (nn%2 == 0) return (uint64_t)(nn/2)*(uint64_t)(nn - 1);
+        return (uint64_t)nn*(uint64_t)((nn - 1)/2);
+    }
+
+    void chirptuner::build(const list<chirpsegment>& profile, double phase0) {
+        check(profile.size() > 0, "need at least one segment");
+        for (int64 ii = 0; ii<profile.size(); ii++) {
+            segment seg;
+            seg.start = profile[ii].start;
+            seg.freq  = fixed(profile[ii].dfreq);
+            seg.rate  = fixed(profile[ii].drate);
+            if (ii == 0) {
+                seg.phase = fixed(phase0);
+            } else {
+                const segment& prev = segments[ii - 1];
+                check(seg.start > prev.start, "segments must increase");
+                int64 nn = seg.start - prev.start;
+                seg.phase = prev.phase + prev.freq*(uint64_t)nn + prev.rate*triangle(nn);
+            }
+
+            seg.chirpre.resize(2048);
+            seg.chirpim.resize(2048);
+            for (int64 kk = 0; kk<1024; kk++) {
+                uint64_t ph = seg.rate*triangle(kk);
+                double angle = 2*M_PI*ph*pow(2.0, -64);
+                seg.chirpre[2*kk + 0] = cos(angle);
+                seg.chirpre[2*kk + 1] = cos(angle);
+                seg.chirpim[2*kk + 0] = -sin(angle);
+                seg.chirpim[2*kk + 1] = sin(angle);
+            }
+            segments.append(seg);
+        }
+    }
+
+    int64 chirptuner::locate(int64 sample) const {
+        int64 lo = 0;
+        int64 hi = segments.size() - 1;
+        while (lo < hi) {
+            int64 mid = (lo + hi + 1)/2;
+            if (segments[mid].start <= sample) lo = mid;
+            else hi = mid - 1;
+        }
+        return lo;
+    }
+
+    uint64_t chirptuner::phase(int64 sample) const {
+        const segment& seg = segments[locate(sample)];
+        int64 nn = sample - seg.start;
+        return seg.phase + seg.freq*(uint64_t)nn + seg.rate*triangle(nn);
+    }
+
+    uint64_t chirptuner::freq(int64 sample) const {
+        const segment& seg = segments[locate(sample)];
+        int64 nn = sample - seg.start;
+        return seg.freq + seg.rate*(uint64_t)nn;
+    }
+
+    void chirptuner::tune(float* ptr, const segment& seg, int64 off, int64 amt) const {
+        const int64 nn = off - seg.start;
+        const uint64_t ph0 = seg.phase + seg.freq*(uint64_t)nn + seg.rate*triangle(nn);
+        const uint64_t fr0 = seg.freq + seg.rate*(uint64_t)nn;
+        const double scale = 2*M_PI*pow(2.0, -64);
+        const i32x4 flip = { 1, 0, 3, 2 };
+
+        // the linear phase within 32 samples, split for SIMD
+        float linre[64], linim[64];
+        for (int64 bb = 0; bb<32; bb++) {
+            double angle = scale*(uint64_t)(fr0*(uint64_t)bb);
+            linre[2*bb + 0] = linre[2*bb + 1] = cos(angle);
+            linim[2*bb + 0] = -sin(angle);
+            linim[2*bb + 1] = +sin(angle);
+        }
+
+        const float* chirpre = seg.chirpre.data();
+        const float* chirpim = seg.chirpim.data();
+        for (int64 aa = 0; aa*32 < amt; aa++) {
+            double angle = scale*(uint64_t)(ph0 + fr0*(uint64_t)(32*aa));
+            const float cc = cos(angle);
+            const float ss = sin(angle);
+            const f32x4 extre = { cc, cc, cc, cc };
+            const f32x4 extim = { -ss, ss, -ss, ss };
+
+            int64 base = 32*aa;
+            int64 count = min(32, amt - base);
+            float* data = ptr + 2*base;
+            const float* cre = chirpre + 2*base;
+            const float* cim = chirpim + 2*base;
+
+            int64 bb = 0;
+            for (; bb + 2 <= count; bb += 2) {
+                f32x4 xx = simdload<f32x4>(data + 2*bb);
+                f32x4 yy = (
+                    xx*simdload<f32x4>(cre + 2*bb) +
+                    __builtin_shuffle(xx, flip)*simdload<f32x4>(cim + 2*bb)
+                );
+                f32x4 zz = (
+                    yy*simdload<f32x4>(linre + 2*bb) +
+                    __builtin_shuffle(yy, flip)*simdload<f32x4>(linim + 2*bb)
+                );
+                simdstore(data + 2*bb, zz*extre + __builtin_shuffle(zz, flip)*extim);
+            }
+            for (; bb < count; bb++) {
+                cfloat xx(data[2*bb + 0], data[2*bb + 1]);
+                cfloat yy = (
+                    xx*cfloat(cre[2*bb], cim[2*bb + 1])*
+                    cfloat(linre[2*bb], linim[2*bb + 1])*cfloat(cc, ss)
+                );
+                data[2*bb + 0] = yy.re;
+                data[2*bb + 1] = yy.im;
+            }
+        }
+    }
+
+    void chirptuner::apply(cfloat* ptr, int64 off, int64 len) {
+        int64 which = locate(off);
+        while (len > 0) {
+            int64 amt = min(len, 1024);
+            // don't let a chunk cross into the next segment
+            while (which + 1 < segments.size() && segments[which + 1].start <= off) {
+                which++;
+            }
+            if (which + 1 < segments.size()) {
+                amt = min(amt, segments[which + 1].start - off);
+            }
+
+            tune((float*)ptr, segments[which], off, amt);
+
+            len -= amt;
+            ptr += amt;
+            off += amt;
+        }
+    }
+
+    template<class type>
+    void chirptuner::apply(cfloat* dst, const complex<type>* src, int64 off, int64 len) {
+        while (len > 0) {
+            int64 amt = min(len, 1024);
+
+            float* ptr = (float*)dst;
+            const type* raw = (const type*)src;
+            for (int64 ii = 0; ii<2*amt; ii++) {
+                ptr[ii] = raw[ii];
+            }
+            apply(dst, off, amt);
+
+            len -= amt;
+            src += amt;
+            dst += amt;
+            off += amt;
+        }
+    }
+
+}
+
+#endif // XM_CHIRPTUNER_H_
+
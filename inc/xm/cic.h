@@ -0,0 +1,206 @@
+#ifndef XM_CIC_H_
+#define XM_CIC_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "simd.h"
+#include "vector.h"
+#include "firwin.h"
+
+namespace xm {
+
+    //
+    // Cascaded integrator comb decimator.  The integrators run at the input
+    // rate and are allowed to overflow, since everything is modulo 2**64
+    // (the build uses -fwrapv), and the combs at the output rate subtract
+    // the wrap back out.  The result is exact as long as the output fits,
+    // which is what the bits argument to the constructor checks.
+    //
+    // The input is frames of interleaved lanes, for instance the real and
+    // imaginary parts of several channels.  Pairs of lanes are integrated
+    // together in one SIMD register, and the number of stages is a template
+    // argument in the inner loop so the integrators stay in registers.
+    //
+    // Output m is the sum over inputs up to (m + 1)*ratio - 1, so its group
+    // delay is stages*(ratio - 1)/2 inputs before that.  The gain is
+    // ratio**stages, and cicfir below designs a compensator for the droop.
+    //
+    struct cic {
+        //~cic() = default;
+        //cic() = default;
+        //cic(const cic&) = default;
+        //cic& operator =(const cic&) = default;
+
+        // bits is the size of the input samples, including the sign
+        inline cic(int64 stages, int64 ratio, int64 lanes, int64 bits);
+
+        // Consumes len input frames, writes the completed output frames
+        // to dst, and returns how many were written (at most len/ratio + 1)
+        template<class type>
+        int64 apply(int64* dst, const type* src, int64 len);
+
+        // ratio**stages
+        inline double gain() const;
+
+        private:
+            int64 stages;
+            int64 ratio;
+            int64 lanes;
+            int64 phase;
+            vector<int64> integ;  // stages per lane
+            vector<int64> combs;  // stages per lane
+            vector<int64> newest; // last integrator output per lane
+
+            template<int count, class type>
+            void integrate(const type* src, int64 len);
+            template<class type>
+            void dispatch(const type* src, int64 len);
+    };
+
+    cic::cic(
+        int64 stages, int64 ratio, int64 lanes, int64 bits
+    ) : stages(stages), ratio(ratio), lanes(lanes), phase(0),
+        integ(stages*lanes), combs(stages*lanes), newest(lanes) {
+        check(stages >= 1 && stages <= 8, "need 1 to 8 stages (%lld)", stages);
+        check(ratio >= 1, "need positive ratio (%lld)", ratio);
+        check(lanes >= 1, "need positive lanes (%lld)", lanes);
+        double growth = stages*log2((double)ratio);
+        check(
+            bits + ceil(growth) <= 64,
+            "%lld stages at ratio %lld need %lld bits for %lld bit input",
+            stages, ratio, bits + (int64)ceil(growth), bits
+        );
+        for (int64 ii = 0; ii<stages*lanes; ii++) {
+            integ[ii] = combs[ii] = 0;
+        }
+    }
+
+    double cic::gain() const {
+        return pow((double)ratio, (double)stages);
+    }
+
+    template<int count, class type>
+    void cic::integrate(const type* src, int64 len) {
+        int64 ll = 0;
+        for (; ll + 2 <= lanes; ll += 2) {
+            i64x2 acc[count];
+            for (int ss = 0; ss<count; ss++) {
+                acc[ss] = (i64x2){ integ[ll*stages + ss], integ[(ll + 1)*stages + ss] };
+            }
+            const type* ptr = src + ll;
+            for (int64 ii = 0; ii<len; ii++) {
+                acc[0] += (i64x2){ ptr[0], ptr[1] };
+                for (int ss = 1; ss<count; ss++) {
+                    acc[ss] += acc[ss - 1];
+                }
+                ptr += lanes;
+            }
+            for (int ss = 0; ss<count; ss++) {
+                integ[ll*stages + ss] = acc[ss][0];
+                integ[(ll + 1)*stages + ss] = acc[ss][1];
+            }
+        }
+        for (; ll < lanes; ll++) {
+            int64 acc[count];
+            for (int ss = 0; ss<count; ss++) {
+                acc[ss] = integ[ll*stages + ss];
+            }
+            const type* ptr = src + ll;
+            for (int64 ii = 0; ii<len; ii++) {
+                acc[0] += *ptr;
+                for (int ss = 1; ss<count; ss++) {
+                    acc[ss] += acc[ss - 1];
+                }
+                ptr += lanes;
+            }
+            for (int ss = 0; ss<count; ss++) {
+                integ[ll*stages + ss] = acc[ss];
+            }
+        }
+    }
+
+    template<class type>
+    void cic::dispatch(const type* src, int64 len) {
+        switch (stages) {
+            case 1: integrate<1>(src, len); break;
+            case 2: integrate<2>(src, len); break;
+            case 3: integrate<3>(src, len); break;
+            case 4: integrate<4>(src, len); break;
+            case 5: integrate<5>(src, len); break;
+            case 6: integrate<6>(src, len); break;
+            case 7: integrate<7>(src, len); break;
+            case 8: integrate<8>(src, len); break;
+        }
+    }
+
+    template<class type>
+    int64 cic::apply(int64* dst, const type* src, int64 len) {
+        int64 written = 0;
+        while (len > 0) {
+            // integrate up to the next output
+            int64 amt = min(len, ratio - phase);
+            dispatch(src, amt);
+            src += amt*lanes;
+            len -= amt;
+            phase += amt;
+            if (phase < ratio) break;
+            phase = 0;
+
+            // the combs only run at the output rate
+            for (int64 ll = 0; ll<lanes; ll++) {
+                int64 val = integ[ll*stages + stages - 1];
+                int64* comb = combs.data() + ll*stages;
+                for (int64 ss = 0; ss<stages; ss++) {
+                    int64 tmp = val - comb[ss];
+                    comb[ss] = val;
+                    val = tmp;
+                }
+                dst[ll] = val;
+            }
+            dst += lanes;
+            written++;
+        }
+        return written;
+    }
+
+    //
+    // Designs a symmetric FIR (at the CIC output rate) which flattens the
+    // droop of the CIC response up to cutoff (cycles per output sample)
+    // and cuts off above that.  The taps are the inverse transform of the
+    // desired response, computed numerically, then windowed with firwin.
+    //
+    static inline vector<double> cicfir(
+        int64 stages, int64 ratio, int window, double cutoff, int64 taps
+    ) {
+        check(taps >= 1, "need positive taps (%lld)", taps);
+        check(cutoff > 0 && cutoff <= .5, "cutoff must be in (0, .5]");
+
+        const int64 points = 4096;
+        vector<double> result(taps);
+        const double center = .5*(taps - 1);
+        double sum = 0;
+        for (int64 kk = 0; kk<taps; kk++) {
+            double xx = kk - center;
+            double acc = 0;
+            for (int64 ii = 0; ii<points; ii++) {
+                double ff = (ii + .5)*cutoff/points;
+                double droop = 1.0;
+                if (ratio > 1) {
+                    droop = fabs(sin(M_PI*ff)/(ratio*sin(M_PI*ff/ratio)));
+                }
+                acc += cos(2*M_PI*ff*xx)/pow(droop, (double)stages);
+            }
+            result[kk] = 2*acc*cutoff/points*firwin(window, xx, taps + 1);
+            sum += result[kk];
+        }
+        for (int64 kk = 0; kk<taps; kk++) {
+            result[kk] /= sum;
+        }
+        return result;
+    }
+
+}
+
+#endif // XM_CIC_H_
+
@@ -0,0 +1,251 @@
+#ifndef XM_DEMOD_H_
+#define XM_DEMOD_H_ 1
+
+#include <math.h>
+#include <string.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "vector.h"
+
+namespace xm {
+
+    namespace internal {
+
+        //
+        // Polynomial atan(z) for z in [0, 1] as z*P(z*z), with coefficients
+        // fit for minimax error.  The max errors in radians, evaluated in
+        // float, are 6.1e-4, 1.2e-5, and 1.1e-7 for accuracy 1, 2, and 3.
+        //
+        template<int accuracy>
+        static inline f32x4 simdatan(const f32x4& zz) {
+            const f32x4 z2 = zz*zz;
+            f32x4 pp;
+            if (accuracy == 1) {
+                pp = z2*0.079339039f - 0.288690236f;
+                pp = pp*z2 + 0.995357955f;
+            } else if (accuracy == 2) {
+                pp = z2*0.0208451138f - 0.0851563503f;
+                pp = pp*z2 + 0.180159295f;
+                pp = pp*z2 - 0.330304786f;
+                pp = pp*z2 + 0.99986633f;
+            } else {
+                pp = z2*-0.00405500505f + 0.0218646135f;
+                pp = pp*z2 - 0.0559148345f;
+                pp = pp*z2 + 0.0964239112f;
+                pp = pp*z2 - 0.139087099f;
+                pp = pp*z2 + 0.199465828f;
+                pp = pp*z2 - 0.333298624f;
+                pp = pp*z2 + 0.999999336f;
+            }
+            return zz*pp;
+        }
+
+        // Folds the angle into [0, pi/4] by octant, and unfolds the result
+        template<int accuracy>
+        static inline f32x4 simdatan2(const f32x4& yy, const f32x4& xx) {
+            const f32x4 zero = { 0, 0, 0, 0 };
+            const f32x4 ax = xx < zero ? -xx : xx;
+            const f32x4 ay = yy < zero ? -yy : yy;
+            const f32x4 big = simdmax(ax, ay);
+            const f32x4 small = simdmin(ax, ay);
+            f32x4 zz = small/big;
+            zz = big > zero ? zz : zero;
+            f32x4 rr = simdatan<accuracy>(zz);
+            rr = ay > ax ? (float)(M_PI/2) - rr : rr;
+            rr = xx < zero ? (float)M_PI - rr : rr;
+            return yy < zero ? -rr : rr;
+        }
+
+        //
+        // Magnitude from a reciprocal square root.  The initial guess comes
+        // from the exponent bits, and each Newton step roughly squares the
+        // relative error: 1.8e-3, 4.7e-6, and float resolution for accuracy
+        // 1, 2, and 3.  A zero power gives a large finite guess, so the
+        // magnitude still comes out as zero.
+        //
+        template<int accuracy>
+        static inline f32x4 simdmag(const f32x4& re, const f32x4& im) {
+            const f32x4 ss = re*re + im*im;
+            f32x4 yy = (f32x4)(0x5f375a86 - (((i32x4)ss) >> 1));
+            for (int ii = 0; ii<accuracy; ii++) {
+                yy = yy*(1.5f - .5f*ss*yy*yy);
+            }
+            return ss*yy;
+        }
+
+        // Splits 4 complex samples into their real and imaginary parts
+        static inline void simdsplit(const cfloat* src, f32x4& re, f32x4& im) {
+            const f32x4 aa = simdload<f32x4>((const float*)src + 0);
+            const f32x4 bb = simdload<f32x4>((const float*)src + 4);
+            re = __builtin_shuffle(aa, bb, (i32x4){ 0, 2, 4, 6 });
+            im = __builtin_shuffle(aa, bb, (i32x4){ 1, 3, 5, 7 });
+        }
+
+        //
+        // The kernels do 4 samples at a time, and the last few go through
+        // a zero padded copy so they get the same approximation.  The
+        // phase difference reads src[-1], which has to be valid.
+        //
+        enum { demodmag, demodangle, demoddiff };
+
+        template<int kernel, int accuracy>
+        static inline void demodblock(float* dst, const cfloat* src, float scale) {
+            f32x4 re, im, result;
+            simdsplit(src, re, im);
+            if (kernel == demodmag) {
+                result = simdmag<accuracy>(re, im);
+            } else if (kernel == demodangle) {
+                result = simdatan2<accuracy>(im, re);
+            } else {
+                // src[n]*conj(src[n - 1])
+                f32x4 pr, pi;
+                simdsplit(src - 1, pr, pi);
+                result = simdatan2<accuracy>(im*pr - re*pi, re*pr + im*pi);
+            }
+            simdstore(dst, result*scale);
+        }
+
+        template<int kernel, int accuracy>
+        static inline void demodsimd(float* dst, const cfloat* src, int64 len, float scale) {
+            int64 ii = 0;
+            for (; ii + 4 <= len; ii += 4) {
+                demodblock<kernel, accuracy>(dst + ii, src + ii, scale);
+            }
+            const int64 rest = len - ii;
+            if (rest <= 0) return;
+            cfloat padded[5];
+            float result[4];
+            memset((void*)padded, 0, sizeof(padded));
+            if (kernel == demoddiff) padded[0] = src[ii - 1];
+            for (int64 jj = 0; jj<rest && jj<4; jj++) {
+                padded[jj + 1] = src[ii + jj];
+            }
+            demodblock<kernel, accuracy>(result, padded + 1, scale);
+            for (int64 jj = 0; jj<rest && jj<4; jj++) {
+                dst[ii + jj] = result[jj];
+            }
+        }
+
+        // Accuracy 0 is the C library
+        template<int kernel>
+        static inline void demodlibm(float* dst, const cfloat* src, int64 len, float scale) {
+            for (int64 ii = 0; ii<len; ii++) {
+                if (kernel == demodmag) {
+                    dst[ii] = scale*sqrtf(mag2(src[ii]));
+                } else if (kernel == demodangle) {
+                    dst[ii] = scale*atan2f(src[ii].im, src[ii].re);
+                } else {
+                    cfloat pp = src[ii]*conj(src[ii - 1]);
+                    dst[ii] = scale*atan2f(pp.im, pp.re);
+                }
+            }
+        }
+
+        template<int kernel>
+        static inline void demodrun(float* dst, const cfloat* src, int64 len, float scale, int accuracy) {
+            switch (accuracy) {
+                case 0: demodlibm<kernel>(dst, src, len, scale); break;
+                case 1: demodsimd<kernel, 1>(dst, src, len, scale); break;
+                case 2: demodsimd<kernel, 2>(dst, src, len, scale); break;
+                default: demodsimd<kernel, 3>(dst, src, len, scale); break;
+            }
+        }
+
+    }
+
+    //
+    // AM, FM, and PM demodulation of complex baseband samples, a block at a
+    // time.  AM is the magnitude, PM is the angle in (-pi, pi], and FM is
+    // the angle of each sample times the conjugate of the one before, in
+    // radians per sample.  Unwrapped PM is the angle of each sample plus
+    // the multiple of 2*pi that puts it nearest the previous phase plus the
+    // FM difference.  The difference only picks the multiple, so its errors
+    // don't add up, and the phase is never off by more than one sample's
+    // angle error.  FM and unwrapped PM carry the last sample and phase from
+    // one call to the next, so splitting a stream into blocks doesn't change
+    // the result.
+    //
+    // Accuracy 0 uses the C library, and 1 to 3 use SIMD polynomials that
+    // trade speed for error (see simdatan and simdmag above).  Outputs are
+    // multiplied by scale, for instance rate/(2*pi) to get FM in Hertz.
+    //
+    struct demod {
+        //~demod() = default;
+        //demod(const demod&) = default;
+        //demod& operator =(const demod&) = default;
+
+        enum kind { am, fm, pm, unwrapped };
+
+        inline demod(kind mode, int accuracy=2, double scale=1.0);
+
+        // Demodulates len samples, following on from the previous call
+        inline void apply(float* dst, const cfloat* src, int64 len);
+
+        // Forgets the carried state, as though starting a new stream
+        inline void reset();
+
+        private:
+            kind mode;
+            int accuracy;
+            float scale;
+            bool started;
+            cfloat last;
+            double phase;
+            vector<float> angles;
+    };
+
+    demod::demod(kind mode, int accuracy, double scale) :
+        mode(mode), accuracy(accuracy), scale(scale) {
+        check(accuracy >= 0 && accuracy <= 3, "accuracy must be 0 to 3 (%d)", accuracy);
+        reset();
+    }
+
+    void demod::reset() {
+        started = false;
+        last = cfloat(0, 0);
+        phase = 0;
+    }
+
+    void demod::apply(float* dst, const cfloat* src, int64 len) {
+        using namespace internal;
+        if (len <= 0) return;
+        if (mode == am) {
+            demodrun<demodmag>(dst, src, len, scale, accuracy);
+            return;
+        }
+        if (mode == pm) {
+            demodrun<demodangle>(dst, src, len, scale, accuracy);
+            return;
+        }
+
+        // the first sample pairs with the last one from before
+        if (!started) {
+            last = src[0];
+            phase = atan2(src[0].im, src[0].re);
+            started = true;
+        }
+        const float factor = mode == fm ? scale : 1.0f;
+        cfloat pair[2] = { last, src[0] };
+        demodrun<demoddiff>(dst, pair + 1, 1, factor, accuracy);
+        demodrun<demoddiff>(dst + 1, src + 1, len - 1, factor, accuracy);
+        last = src[len - 1];
+
+        if (mode == unwrapped) {
+            if (angles.size() < len) angles.resize(len);
+            float* aa = angles.data();
+            demodrun<demodangle>(aa, src, len, 1.0f, accuracy);
+            const double turn = 2*M_PI;
+            for (int64 ii = 0; ii<len; ii++) {
+                const double wraps = floor((phase + dst[ii] - aa[ii])/turn + .5);
+                phase = aa[ii] + wraps*turn;
+                dst[ii] = phase*scale;
+            }
+        }
+    }
+
+}
+
+#endif // XM_DEMOD_H_
+
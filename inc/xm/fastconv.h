@@ -0,0 +1,265 @@
+#ifndef XM_FASTCONV_H_
+#define XM_FASTCONV_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "vector.h"
+#include "kissfft.h"
+
+namespace xm {
+
+    //
+    // Streaming FIR filter with optional decimation, which picks between
+    // overlap-save fast convolution and direct form by estimating the cost
+    // of each.  With T taps and an FFT of size N, each block of overlap-save
+    // transforms N inputs, multiplies by the transform of the taps, and
+    // keeps the last N - T + 1 outputs, so long filters cost O(log N) per
+    // sample instead of O(T).  Direct form only computes the outputs that
+    // are kept, so it wins for short filters or large decimations.
+    //
+    // Like halfband, the filter's delay is removed: output m is centered on
+    // input m*decim (the taps are centered on (T - 1)/2), the input is zero
+    // before the start and after the end, and there are (count + decim -
+    // 1)/decim outputs in total, with the last ones coming from flush().
+    //
+    struct fastconv {
+        //~fastconv() = default;
+        //fastconv() = default;
+        //fastconv(const fastconv&) = default;
+        //fastconv& operator =(const fastconv&) = default;
+
+        // Real or complex taps.  An fftsize of 0 picks the fastest method,
+        // 1 forces direct form, and a power of 2 forces overlap-save.
+        inline fastconv(const vector<float>& taps, int64 decim=1, int64 fftsize=0);
+        inline fastconv(const vector<cfloat>& taps, int64 decim=1, int64 fftsize=0);
+
+        // Consumes len inputs, writes to dst, and returns how many outputs
+        // were written.  Outputs come a block at a time, so that can be up
+        // to capacity(len).
+        inline int64 apply(cfloat* dst, const cfloat* src, int64 len);
+
+        // Writes the remaining outputs (at most capacity(0)) and returns
+        // how many there were
+        inline int64 flush(cfloat* dst);
+
+        // The most outputs apply() can write for len inputs
+        inline int64 capacity(int64 len) const;
+
+        // The FFT size for overlap-save, or 0 for direct form
+        inline int64 fftsize() const;
+
+        private:
+            int64 count;           // number of taps
+            int64 decim;
+            int64 center;          // (count - 1)/2
+            int64 fsize;           // 0 for direct form
+            int64 block;           // full rate outputs per block
+            bool realtaps;
+            int64 have;            // samples in pending
+            int64 base;            // full rate index of the block's first output
+            int64 total;           // inputs consumed so far
+            int64 written;         // outputs produced so far
+            vector<float> rr;      // reversed taps, real parts duplicated
+            vector<float> ii;      // reversed taps, (-imag, imag)
+            vector<cfloat> filter; // transform of the taps, scaled by 1/N
+            vector<cfloat> pending;
+            vector<cfloat> freq;
+            vector<cfloat> scratch;
+            kissfft<float> forward;
+            kissfft<float> inverse;
+
+            inline void setup(const vector<cfloat>& taps, int64 fftsize);
+            inline int64 run(cfloat* dst, int64 limit);
+            inline cfloat direct(const cfloat* src) const;
+            static inline int64 choose(int64 count, int64 decim, bool realtaps);
+    };
+
+    //
+    // Rough costs per output in nanoseconds, fit to timings of the direct
+    // form and SIMD FFT kernels.  Real taps are half as much work in direct
+    // form, but make no difference to the FFT.  Past 64K points the FFT
+    // falls out of cache, so bigger sizes are only used for very long
+    // filters.
+    //
+    int64 fastconv::choose(int64 count, int64 decim, bool realtaps) {
+        double best = 6 + (realtaps ? .45 : .85)*count;
+        int64 result = 1;
+        int64 size = 1;
+        while (size < 2*count) size *= 2;
+        const int64 most = max(65536, 2*size);
+        for (; size <= most; size *= 2) {
+            double cost = .9*decim*size*(log2((double)size) + 2)/(size - count + 1);
+            if (cost < best) {
+                best = cost;
+                result = size;
+            }
+        }
+        return result;
+    }
+
+    fastconv::fastconv(
+        const vector<float>& taps, int64 decim, int64 fftsize
+    ) : count(taps.size()), decim(decim), realtaps(true), forward(0), inverse(0) {
+        vector<cfloat> cplx(taps.size());
+        for (int64 kk = 0; kk<taps.size(); kk++) {
+            cplx[kk] = cfloat(taps[kk], 0);
+        }
+        setup(cplx, fftsize);
+    }
+
+    fastconv::fastconv(
+        const vector<cfloat>& taps, int64 decim, int64 fftsize
+    ) : count(taps.size()), decim(decim), realtaps(true), forward(0), inverse(0) {
+        for (int64 kk = 0; kk<taps.size(); kk++) {
+            if (taps[kk].im != 0) realtaps = false;
+        }
+        setup(taps, fftsize);
+    }
+
+    void fastconv::setup(const vector<cfloat>& taps, int64 fftsize) {
+        check(count >= 1, "need at least one tap");
+        check(decim >= 1, "need positive decimation (%lld)", decim);
+        check(
+            fftsize == 0 || fftsize == 1 || (fftsize >= count && (fftsize & (fftsize - 1)) == 0),
+            "fftsize must be 0, 1, or a power of 2 at least the number of taps"
+        );
+        center = (count - 1)/2;
+        if (fftsize == 0) fftsize = choose(count, decim, realtaps);
+        fsize = fftsize == 1 ? 0 : fftsize;
+
+        // the reversed taps, split for SIMD multiplies, padded to pairs
+        const int64 pairs = (count + 1)/2;
+        rr.resize(4*pairs, 0.0f);
+        ii.resize(4*pairs, 0.0f);
+        for (int64 jj = 0; jj<count; jj++) {
+            const cfloat& tap = taps[count - 1 - jj];
+            rr[2*jj + 0] = tap.re;
+            rr[2*jj + 1] = tap.re;
+            ii[2*jj + 0] = -tap.im;
+            ii[2*jj + 1] = tap.im;
+        }
+
+        if (fsize) {
+            block = fsize - count + 1;
+            forward = kissfft<float>(fsize);
+            inverse = kissfft<float>(fsize, true);
+            vector<cfloat> padded(fsize, cfloat(0, 0));
+            for (int64 jj = 0; jj<count; jj++) {
+                padded[jj] = taps[jj]/(float)fsize;
+            }
+            filter.resize(fsize);
+            forward.exec(filter.data(), padded.data());
+            freq.resize(fsize);
+            scratch.resize(max(forward.scratch_size(), inverse.scratch_size()));
+        } else {
+            block = 8192;
+        }
+
+        // pending[0] is input base - (count - 1), and starts as the zeros
+        // before the first input
+        pending.resize(block + count - 1 + 2, cfloat(0, 0));
+        have = count - 1;
+        base = 0;
+        total = 0;
+        written = 0;
+    }
+
+    int64 fastconv::capacity(int64 len) const {
+        return (len + block + count)/decim + 2;
+    }
+
+    int64 fastconv::fftsize() const {
+        return fsize;
+    }
+
+    cfloat fastconv::direct(const cfloat* src) const {
+        const float* xx = (const float*)src;
+        const float* pr = rr.data();
+        const float* pi = ii.data();
+        const int64 pairs = (count + 1)/2;
+        f32x4 acc = { 0, 0, 0, 0 };
+        if (realtaps) {
+            for (int64 jj = 0; jj<pairs; jj++) {
+                acc += simdload<f32x4>(xx + 4*jj)*simdload<f32x4>(pr + 4*jj);
+            }
+        } else {
+            for (int64 jj = 0; jj<pairs; jj++) {
+                f32x4 val = simdload<f32x4>(xx + 4*jj);
+                acc += val*simdload<f32x4>(pr + 4*jj);
+                acc += __builtin_shuffle(val, (i32x4){ 1, 0, 3, 2 })*simdload<f32x4>(pi + 4*jj);
+            }
+        }
+        return cfloat(acc[0] + acc[2], acc[1] + acc[3]);
+    }
+
+    int64 fastconv::run(cfloat* dst, int64 limit) {
+        // the outputs in this block are at full rate indices
+        // [base, base + block), and output m is at m*decim + center
+        int64 result = 0;
+        if (fsize) {
+            forward.exec(freq.data(), pending.data(), scratch.data());
+            for (int64 kk = 0; kk<fsize; kk++) {
+                freq[kk] *= filter[kk];
+            }
+            inverse.exec(freq.data(), freq.data(), scratch.data());
+            for (int64 nn = written*decim + center; nn < base + block; nn += decim) {
+                if (result == limit) break;
+                dst[result++] = freq[nn - base + count - 1];
+            }
+        } else {
+            for (int64 nn = written*decim + center; nn < base + block; nn += decim) {
+                if (result == limit) break;
+                dst[result++] = direct(pending.data() + (nn - base));
+            }
+        }
+        written += result;
+
+        // keep what the next block still needs
+        base += block;
+        have -= block;
+        for (int64 jj = 0; jj<have; jj++) {
+            pending[jj] = pending[block + jj];
+        }
+        return result;
+    }
+
+    int64 fastconv::apply(cfloat* dst, const cfloat* src, int64 len) {
+        const int64 full = block + count - 1;
+        int64 result = 0;
+        while (len > 0) {
+            int64 amt = min(len, full - have);
+            for (int64 jj = 0; jj<amt; jj++) {
+                pending[have + jj] = src[jj];
+            }
+            have += amt;
+            total += amt;
+            src += amt;
+            len -= amt;
+            if (have == full) {
+                result += run(dst + result, -1);
+            }
+        }
+        return result;
+    }
+
+    int64 fastconv::flush(cfloat* dst) {
+        const int64 full = block + count - 1;
+        const int64 last = (total + decim - 1)/decim;
+        int64 result = 0;
+        while (written < last) {
+            for (int64 jj = have; jj<full; jj++) {
+                pending[jj] = cfloat(0, 0);
+            }
+            have = full;
+            result += run(dst + result, last - written);
+        }
+        return result;
+    }
+
+}
+
+#endif // XM_FASTCONV_H_
+
@@ -0,0 +1,758 @@
+#ifndef XM_FIRPARKS_H_
+#define XM_FIRPARKS_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "list.h"
+#include "vector.h"
+#include "simd.h"
+#include "parallel.h"
+#include "kissfft.h"
+
+namespace xm {
+
+    namespace internal {
+
+        // A point on the dense grid, at ff as a fraction of Nyquist and xx
+        // as cos(pi*ff)
+        struct parkspoint {
+            double ff;
+            double xx;
+            double want;
+            double weight;
+            int64 band;
+        };
+
+        //
+        // Barycentric weights 1/prod(xx[k] - xx[j]) for j != k, where xx is
+        // cos(pi*ff).  Subtracting cosines near +1 or -1 loses most of the
+        // digits, so each difference comes from the half angles instead:
+        // cos(a) - cos(b) = 2*(sin(b/2)^2 - sin(a/2)^2), or the same with
+        // cos(a/2) and the sign flipped, whichever pair is smaller.  With
+        // thousands of points the products overflow a double many times
+        // over, so the exponent is moved out with frexp every few factors,
+        // and the results are scaled so the biggest is near one.  Only the
+        // ratios between the weights matter.
+        //
+        static inline void parksweights(double* dst, const double* ff, int64 len) {
+            vector<double> ss(len), cc(len);
+            for (int64 kk = 0; kk<len; kk++) {
+                ss[kk] = sin(M_PI*ff[kk]/2);
+                cc[kk] = cos(M_PI*ff[kk]/2);
+            }
+            vector<int> exps(len);
+            int top = 0;
+            for (int64 kk = 0; kk<len; kk++) {
+                double prod = 1;
+                int exp = 0;
+                for (int64 block = 0; block<len; block += 16) {
+                    // 16 differences can't overflow or underflow
+                    const int64 stop = min(len, block + 16);
+                    double part = 1;
+                    for (int64 jj = block; jj<stop; jj++) {
+                        const double viasin = 2*(ss[jj] - ss[kk])*(ss[jj] + ss[kk]);
+                        const double viacos = 2*(cc[kk] - cc[jj])*(cc[kk] + cc[jj]);
+                        const double diff = ss[kk] + ss[jj] < cc[kk] + cc[jj] ? viasin : viacos;
+                        part *= jj == kk ? 1.0 : diff;
+                    }
+                    int ee;
+                    prod = frexp(prod*part, &ee);
+                    exp += ee;
+                }
+                dst[kk] = 1/prod;
+                exps[kk] = -exp;
+                if (kk == 0 || exps[kk] > top) top = exps[kk];
+            }
+            for (int64 kk = 0; kk<len; kk++) {
+                dst[kk] = ldexp(dst[kk], exps[kk] - top);
+            }
+        }
+
+        //
+        // The barycentric form of the polynomial through (nodes, values),
+        // which is stable and costs one division per node.  Landing right
+        // on a node makes a NaN, and then the value at that node is used.
+        //
+        static inline double parkseval(
+            double xx, const double* nodes, const double* weights,
+            const double* values, int64 len
+        ) {
+            const f64x2 here = { xx, xx };
+            f64x2 num0 = { 0, 0 }, num1 = { 0, 0 };
+            f64x2 den0 = { 0, 0 }, den1 = { 0, 0 };
+            int64 kk = 0;
+            for (; kk + 4 <= len; kk += 4) {
+                const f64x2 t0 = (
+                    simdload<f64x2>(weights + kk + 0)/(here - simdload<f64x2>(nodes + kk + 0))
+                );
+                const f64x2 t1 = (
+                    simdload<f64x2>(weights + kk + 2)/(here - simdload<f64x2>(nodes + kk + 2))
+                );
+                num0 += t0*simdload<f64x2>(values + kk + 0);
+                num1 += t1*simdload<f64x2>(values + kk + 2);
+                den0 += t0;
+                den1 += t1;
+            }
+            double nn = (num0[0] + num0[1]) + (num1[0] + num1[1]);
+            double dd = (den0[0] + den0[1]) + (den1[0] + den1[1]);
+            for (; kk<len; kk++) {
+                const double tt = weights[kk]/(xx - nodes[kk]);
+                nn += tt*values[kk];
+                dd += tt;
+            }
+            const double result = nn/dd;
+            if (result == result) return result;
+            for (kk = 0; kk<len; kk++) {
+                if (xx == nodes[kk]) return values[kk];
+            }
+            return result;
+        }
+
+        // Weighted errors at a chunk of the listed grid points per index,
+        // with the largest one in each chunk
+        struct parkserrors {
+            const parkspoint* grid;
+            const int64* points;
+            int64 count, chunk, len;
+            const double* nodes;
+            const double* weights;
+            const double* values;
+            double* error;
+            double* worst;
+
+            void operator ()(int64 index) {
+                const int64 stop = min(count, (index + 1)*chunk);
+                double most = 0;
+                for (int64 ii = index*chunk; ii<stop; ii++) {
+                    const parkspoint& pp = grid[points[ii]];
+                    const double got = parkseval(pp.xx, nodes, weights, values, len);
+                    error[points[ii]] = pp.weight*(pp.want - got);
+                    most = max(most, fabs(error[points[ii]]));
+                }
+                worst[index] = most;
+            }
+        };
+
+        //
+        // Weighted errors of the finished cosine series, by Clenshaw's
+        // recurrence, at a chunk of the grid per index.  This checks what
+        // the taps will actually do, which can be worse than the exchange
+        // thought when the ripple gets near the limits of double precision.
+        //
+        struct parksseries {
+            const parkspoint* grid;
+            const double* coefs;
+            int64 count, chunk, terms;
+            double* worst;
+
+            double error(const parkspoint& pp, double b1, double b2) const {
+                const double got = coefs[0] + pp.xx*b1 - b2;
+                return fabs(pp.weight*(pp.want - got));
+            }
+
+            // four points at a time, since each recurrence is a serial chain
+            void operator ()(int64 index) {
+                const int64 stop = min(count, (index + 1)*chunk);
+                double most = 0;
+                int64 ii = index*chunk;
+                for (; ii + 4 <= stop; ii += 4) {
+                    const parkspoint* pp = grid + ii;
+                    const f64x2 x0 = { 2*pp[0].xx, 2*pp[1].xx };
+                    const f64x2 x1 = { 2*pp[2].xx, 2*pp[3].xx };
+                    f64x2 b10 = { 0, 0 }, b20 = { 0, 0 };
+                    f64x2 b11 = { 0, 0 }, b21 = { 0, 0 };
+                    for (int64 kk = terms - 1; kk >= 1; kk--) {
+                        const double cc = 2*coefs[kk];
+                        const f64x2 b00 = cc + x0*b10 - b20;
+                        const f64x2 b01 = cc + x1*b11 - b21;
+                        b20 = b10;
+                        b10 = b00;
+                        b21 = b11;
+                        b11 = b01;
+                    }
+                    most = max(most, error(pp[0], b10[0], b20[0]));
+                    most = max(most, error(pp[1], b10[1], b20[1]));
+                    most = max(most, error(pp[2], b11[0], b21[0]));
+                    most = max(most, error(pp[3], b11[1], b21[1]));
+                }
+                for (; ii<stop; ii++) {
+                    double b1 = 0, b2 = 0;
+                    for (int64 kk = terms - 1; kk >= 1; kk--) {
+                        const double b0 = 2*coefs[kk] + 2*grid[ii].xx*b1 - b2;
+                        b2 = b1;
+                        b1 = b0;
+                    }
+                    most = max(most, error(grid[ii], b1, b2));
+                }
+                worst[index] = most;
+            }
+        };
+
+        //
+        // Moves each extremal point uphill on the error, one grid point at
+        // a time, until it reaches the top of its lobe or the band edge.
+        // Once the set is close, this finds the next one with a few
+        // evaluations per point instead of the whole grid.
+        //
+        struct parksclimb {
+            const parkspoint* grid;
+            const int64* starts;
+            const int64* extremal;
+            int64* moved;
+            double* height;
+            int64 count, chunk, len;
+            const double* nodes;
+            const double* weights;
+            const double* values;
+
+            double error(int64 gg) const {
+                const parkspoint& pp = grid[gg];
+                return pp.weight*(pp.want - parkseval(pp.xx, nodes, weights, values, len));
+            }
+
+            void operator ()(int64 index) {
+                const int64 stop = min(count, (index + 1)*chunk);
+                for (int64 kk = index*chunk; kk<stop; kk++) {
+                    const int64 gg = extremal[kk];
+                    const int64 lo = starts[grid[gg].band];
+                    const int64 hi = starts[grid[gg].band + 1] - 1;
+                    const double start = error(gg);
+                    const double sign = start > 0 ? 1 : -1;
+                    const double here = sign*start;
+                    const double left = gg > lo ? sign*error(gg - 1) : -HUGE_VAL;
+                    const double right = gg < hi ? sign*error(gg + 1) : -HUGE_VAL;
+                    int64 step = 0;
+                    double best = here;
+                    if (left > here && left >= right) {
+                        step = -1;
+                        best = left;
+                    } else if (right > here) {
+                        step = 1;
+                        best = right;
+                    }
+                    int64 at = gg + step;
+                    while (step != 0 && at + step >= lo && at + step <= hi) {
+                        const double next = sign*error(at + step);
+                        if (next <= best) break;
+                        best = next;
+                        at += step;
+                    }
+                    moved[kk] = at;
+                    height[kk] = best;
+                }
+            }
+        };
+
+        //
+        // The dense grid for each band, evenly spaced in frequency with
+        // both edges included.  The starts list has where each band begins
+        // in the grid, and one more for the end.  An even count is cos(w/2)
+        // times a cosine series, so the want and weight are adjusted to
+        // make the error the same for the series, and the grid stops short
+        // of Nyquist where cos(w/2) is zero.
+        //
+        static inline void parksgrid(
+            list<parkspoint>& grid, list<int64>& starts, bool odd, double step,
+            int64 bands, const double* edges, const double* gains, const double* weights
+        ) {
+            for (int64 bb = 0; bb<bands; bb++) {
+                const double lo = edges[2*bb];
+                const double hi = odd ? edges[2*bb + 1] : min(edges[2*bb + 1], 1 - step);
+                check(lo <= hi, "band %lld is too close to Nyquist for even taps", bb);
+                starts.append(grid.size());
+                const int64 first = (int64)floor(lo/step) + 1;
+                for (int64 mm = first - 1;; mm++) {
+                    parkspoint pp;
+                    pp.ff = mm < first ? lo : min(mm*step, hi);
+                    pp.xx = cos(M_PI*pp.ff);
+                    const double fract = hi > lo ? (pp.ff - lo)/(hi - lo) : 0;
+                    pp.want = gains[2*bb] + fract*(gains[2*bb + 1] - gains[2*bb]);
+                    pp.weight = weights[bb];
+                    pp.band = bb;
+                    if (!odd) {
+                        const double half = cos(M_PI*pp.ff/2);
+                        pp.want /= half;
+                        pp.weight *= half;
+                    }
+                    grid.append(pp);
+                    if (pp.ff == hi) break;
+                }
+            }
+            starts.append(grid.size());
+        }
+
+        //
+        // The starting extremal set comes from the final set of a design
+        // with fewer terms: each band gets its share of the new points, and
+        // they are spread out like the old points in that band.  Starting
+        // evenly spaced works for short filters, but with thousands of taps
+        // the first guess is so far off that the error doesn't alternate
+        // enough times to make the next set.
+        //
+        static inline void parksscale(
+            list<int64>& extremal, const list<double>& prior, int64 terms,
+            const list<parkspoint>& grid, const list<int64>& starts
+        ) {
+            const int64 bands = starts.size() - 1;
+            const int64 size = grid.size();
+            const int64 extra = terms + 1 - prior.size();
+            double total = 0, covered = 0;
+            for (int64 bb = 0; bb<bands; bb++) {
+                total += grid[starts[bb + 1] - 1].ff - grid[starts[bb]].ff;
+            }
+            int64 added = 0;
+            for (int64 bb = 0; bb<bands; bb++) {
+                const double lo = grid[starts[bb]].ff;
+                const double hi = grid[starts[bb + 1] - 1].ff;
+                list<double> here;
+                for (int64 ii = 0; ii<prior.size(); ii++) {
+                    if (prior[ii] >= lo && prior[ii] <= hi) here.append(prior[ii]);
+                }
+                covered += hi - lo;
+                const int64 more = llrint(extra*covered/total) - added;
+                added += more;
+                const int64 want = here.size() + more;
+                for (int64 jj = 0; jj<want; jj++) {
+                    const double tt = want > 1 ? jj*(here.size() - 1.0)/(want - 1) : 0;
+                    const int64 below = min((int64)tt, here.size() - 1);
+                    const int64 above = min(below + 1, here.size() - 1);
+                    const double ff = here[below] + (tt - below)*(here[above] - here[below]);
+
+                    // the first grid point in the band at or after ff
+                    int64 lower = starts[bb], upper = starts[bb + 1] - 1;
+                    while (lower < upper) {
+                        const int64 middle = (lower + upper)/2;
+                        if (grid[middle].ff < ff) lower = middle + 1;
+                        else upper = middle;
+                    }
+                    if (extremal.size() > 0) {
+                        lower = max(lower, extremal[extremal.size() - 1] + 1);
+                    }
+                    extremal.append(min(lower, size - 1));
+                }
+            }
+
+            bool usable = extremal.size() == terms + 1;
+            for (int64 kk = 1; usable && kk<extremal.size(); kk++) {
+                usable = extremal[kk] > extremal[kk - 1];
+            }
+            if (usable) return;
+            extremal.clear();
+            for (int64 kk = 0; kk <= terms; kk++) {
+                extremal.append(kk*(size - 1)/terms);
+            }
+        }
+
+        // Every stride'th point of each band and its last one, with where
+        // each band starts among them and one more for the end
+        struct parksview {
+            list<int64> points;
+            list<int64> starts;
+        };
+
+        static inline void parkssubset(parksview& view, const list<int64>& starts, int64 stride) {
+            for (int64 bb = 0; bb + 1<starts.size(); bb++) {
+                view.starts.append(view.points.size());
+                for (int64 gg = starts[bb]; gg<starts[bb + 1]; gg += stride) {
+                    view.points.append(gg);
+                }
+                const int64 last = starts[bb + 1] - 1;
+                if (view.points[view.points.size() - 1] != last) view.points.append(last);
+            }
+            view.starts.append(view.points.size());
+        }
+
+        static inline double parksevaluate(
+            parkserrors& errors, const parksview& view, threadpool& pool
+        ) {
+            const int64 count = view.points.size();
+            const int64 tasks = min(count, 8*pool.size());
+            vector<double> most(tasks);
+            errors.points = view.points.data();
+            errors.count = count;
+            errors.chunk = (count + tasks - 1)/tasks;
+            errors.worst = most.data();
+            pool.parfor(tasks, errors);
+            double worst = 0;
+            for (int64 ii = 0; ii<tasks; ii++) {
+                worst = max(worst, most[ii]);
+            }
+            return worst;
+        }
+
+        //
+        // The local extremes in the view at least as big as least, with
+        // alternating signs, trimmed to the count needed.  This returns
+        // false if there aren't enough of them.
+        //
+        static inline bool parksexchange(
+            list<int64>& found, const parksview& view, const double* error,
+            double least, int64 terms
+        ) {
+            for (int64 bb = 0; bb + 1<view.starts.size(); bb++) {
+                const int64 lo = view.starts[bb], hi = view.starts[bb + 1];
+                for (int64 ii = lo; ii<hi; ii++) {
+                    const double ee = error[view.points[ii]];
+                    if (fabs(ee) < least) continue;
+                    const double before = ii > lo ? error[view.points[ii - 1]] : ee;
+                    const double after = ii + 1 < hi ? error[view.points[ii + 1]] : ee;
+                    if (ee > 0 ? (ee < before || ee < after) : (ee > before || ee > after)) {
+                        continue;
+                    }
+                    const int64 last = found.size() - 1;
+                    if (last >= 0 && (error[found[last]] > 0) == (ee > 0)) {
+                        if (fabs(ee) > fabs(error[found[last]])) found[last] = view.points[ii];
+                        continue;
+                    }
+                    found.append(view.points[ii]);
+                }
+            }
+            if (found.size() < terms + 1) return false;
+
+            // Too many: an end can go by itself, but taking one from the
+            // middle leaves two neighbors with the same sign, so the smaller
+            // of those goes too.
+            while (found.size() > terms + 1) {
+                const int64 last = found.size() - 1;
+                int64 low = 0;
+                for (int64 ii = 1; ii <= last; ii++) {
+                    if (fabs(error[found[ii]]) < fabs(error[found[low]])) low = ii;
+                }
+                if (low == 0 || low == last || found.size() == terms + 2) {
+                    const bool front = fabs(error[found[0]]) < fabs(error[found[last]]);
+                    if (low != 0 && low != last) low = front ? 0 : last;
+                    found.remove(low);
+                    continue;
+                }
+                const bool left = fabs(error[found[low - 1]]) < fabs(error[found[low + 1]]);
+                found.remove(left ? low - 1 : low + 1);
+                found.remove(left ? low - 1 : low);
+            }
+            return true;
+        }
+
+        // Too few alternations means the ripple has fallen into the
+        // rounding noise, and more iterations won't fix that
+        static inline void parkscheck(bool enough, int64 terms, double delta) {
+            check(
+                enough, "can't find %lld alternations, ripple %lg is too small "
+                "for double precision", terms + 1, fabs(delta)
+            );
+        }
+
+        static inline double parksmeasure(
+            const double* coefs, int64 terms, const list<parkspoint>& grid,
+            threadpool& pool
+        ) {
+            const int64 count = grid.size();
+            const int64 tasks = min(count, 8*pool.size());
+            vector<double> most(tasks);
+            parksseries series;
+            series.grid = grid.data();
+            series.coefs = coefs;
+            series.count = count;
+            series.chunk = (count + tasks - 1)/tasks;
+            series.terms = terms;
+            series.worst = most.data();
+            pool.parfor(tasks, series);
+            double worst = 0;
+            for (int64 ii = 0; ii<tasks; ii++) {
+                worst = max(worst, most[ii]);
+            }
+            return worst;
+        }
+
+        //
+        // Remez exchange over the grid, starting from the extremal set and
+        // leaving the final one there.  The coefs are the cosine series,
+        // halved except for the first, and the return value is the largest
+        // weighted error on the grid.
+        //
+        // While the error is far from level, the exchange looks at every
+        // stride'th grid point and then climbs to the exact tops.  Once it
+        // gets close, climbing alone moves the set, and the whole grid is
+        // only checked when climbing stops changing anything.
+        //
+        static inline double parksremez(
+            double* coefs, list<int64>& extremal, int64 terms, int64 stride,
+            const list<parkspoint>& grid, const list<int64>& starts, threadpool& pool
+        ) {
+            const int64 size = grid.size();
+            vector<double> freqs(terms + 1), nodes(terms + 1), bary(terms + 1);
+            vector<double> values(terms + 1), interp(terms + 1), error(size);
+            const int64 skip = terms/2;
+
+            parksview full, sparse;
+            parkssubset(full, starts, 1);
+            parkssubset(sparse, starts, stride);
+
+            parkserrors errors;
+            errors.grid = grid.data();
+            errors.len = terms + 1;
+            errors.nodes = nodes.data();
+            errors.weights = interp.data();
+            errors.values = values.data();
+            errors.error = error.data();
+
+            const int64 climbs = min(terms + 1, 8*pool.size());
+            vector<int64> moved(terms + 1);
+            vector<double> height(terms + 1);
+            parksclimb climb;
+            climb.grid = grid.data();
+            climb.starts = starts.data();
+            climb.moved = moved.data();
+            climb.height = height.data();
+            climb.count = terms + 1;
+            climb.chunk = (terms + climbs)/climbs;
+            climb.len = terms + 1;
+            climb.nodes = nodes.data();
+            climb.weights = interp.data();
+            climb.values = values.data();
+
+            bool climbing = false, checked = false, converged = false;
+            double worst = 0, delta = 0;
+            for (int64 iteration = 0; iteration<100; iteration++) {
+
+                // the ripple that alternates on the extremal set
+                for (int64 kk = 0; kk <= terms; kk++) {
+                    freqs[kk] = grid[extremal[kk]].ff;
+                    nodes[kk] = grid[extremal[kk]].xx;
+                }
+                parksweights(bary.data(), freqs.data(), terms + 1);
+                double num = 0, den = 0;
+                for (int64 kk = 0; kk <= terms; kk++) {
+                    const parkspoint& pp = grid[extremal[kk]];
+                    num += bary[kk]*pp.want;
+                    den += (kk%2 ? -bary[kk] : bary[kk])/pp.weight;
+                }
+                delta = num/den;
+
+                //
+                // Any terms of the points pin down the series.  Leaving one
+                // out of the middle with a zero weight, rather than one at
+                // the end, means the error near the ends doesn't come from
+                // extrapolating.
+                //
+                for (int64 kk = 0; kk <= terms; kk++) {
+                    const parkspoint& pp = grid[extremal[kk]];
+                    values[kk] = pp.want - (kk%2 ? -delta : delta)/pp.weight;
+                    interp[kk] = bary[kk]*(nodes[kk] - nodes[skip]);
+                }
+                checked = false;
+
+                list<int64> found;
+                if (climbing) {
+                    climb.extremal = extremal.data();
+                    pool.parfor(climbs, climb);
+                    bool changed = false, ordered = true;
+                    for (int64 kk = 0; kk <= terms; kk++) {
+                        changed = changed || moved[kk] != extremal[kk];
+                        ordered = ordered && (kk == 0 || moved[kk] > moved[kk - 1]);
+                    }
+                    if (changed && ordered) {
+                        for (int64 kk = 0; kk <= terms; kk++) {
+                            extremal[kk] = moved[kk];
+                        }
+                        continue;
+                    }
+
+                    worst = parksevaluate(errors, full, pool);
+                    checked = true;
+                    converged = worst <= fabs(delta)*(1 + 1e-4);
+                    if (converged) break;
+                    const bool enough = parksexchange(
+                        found, full, error.data(), fabs(delta)*(1 - 1e-3), terms
+                    );
+                    parkscheck(enough, terms, delta);
+                    bool same = true;
+                    for (int64 kk = 0; kk <= terms; kk++) {
+                        same = same && found[kk] == extremal[kk];
+                    }
+                    // nothing left to exchange, so this is as level as it gets
+                    converged = same;
+                    if (converged) break;
+                    extremal = found;
+                    continue;
+                }
+
+                const double rough = parksevaluate(errors, sparse, pool);
+                if (!parksexchange(found, sparse, error.data(), fabs(delta)/2, terms)) {
+                    // a lobe narrower than the stride, so look at everything
+                    worst = parksevaluate(errors, full, pool);
+                    checked = true;
+                    converged = worst <= fabs(delta)*(1 + 1e-4);
+                    if (converged) break;
+                    found.clear();
+                    const bool enough = parksexchange(
+                        found, full, error.data(), fabs(delta)*(1 - 1e-3), terms
+                    );
+                    parkscheck(enough, terms, delta);
+                    extremal = found;
+                    climbing = worst < 1.5*fabs(delta);
+                    continue;
+                }
+                climb.extremal = found.data();
+                pool.parfor(climbs, climb);
+                bool ordered = true;
+                for (int64 kk = 1; kk <= terms; kk++) {
+                    ordered = ordered && moved[kk] > moved[kk - 1];
+                }
+                for (int64 kk = 0; kk <= terms; kk++) {
+                    extremal[kk] = ordered ? moved[kk] : found[kk];
+                }
+                climbing = rough < 1.5*fabs(delta);
+            }
+            check(converged, "no convergence in 100 iterations for %lld terms", terms);
+            if (!checked) worst = parksevaluate(errors, full, pool);
+
+            // The series from samples at evenly spaced angles, a few more
+            // than there are terms, so the FFT doesn't alias
+            int64 coarse = 4;
+            while (coarse < 2*terms) coarse *= 2;
+            vector<cdouble> samples(coarse);
+            for (int64 mm = 0; mm <= coarse/2; mm++) {
+                const double val = parkseval(
+                    cos(2*M_PI*mm/coarse), nodes.data(), interp.data(),
+                    values.data(), terms + 1
+                );
+                samples[mm] = samples[(coarse - mm)%coarse] = cdouble(val, 0);
+            }
+            kissfft<double> fft(coarse);
+            fft.exec(samples.data(), samples.data());
+            for (int64 kk = 0; kk<terms; kk++) {
+                coefs[kk] = samples[kk].re/coarse;
+            }
+
+            const double actual = parksmeasure(coefs, terms, grid, pool);
+            check(
+                actual <= 1.1*worst, "ripple %lg is too small for double "
+                "precision, the %lld terms come out at %lg", worst, terms, actual
+            );
+            return actual;
+        }
+
+        // Designs the cosine series, and leaves the final extremal
+        // frequencies in extremes for a bigger design to start from
+        static inline double parksdesign(
+            double* coefs, list<double>& extremes, int64 count, int64 bands,
+            const double* edges, const double* gains, const double* weights,
+            int64 density, threadpool& pool
+        ) {
+            const bool odd = count%2 == 1;
+            const int64 terms = odd ? (count + 1)/2 : count/2;
+
+            list<parkspoint> grid;
+            list<int64> starts;
+            parksgrid(
+                grid, starts, odd, 1.0/(density*terms),
+                bands, edges, gains, weights
+            );
+            const int64 size = grid.size();
+            check(size > terms, "bands are too narrow for %lld taps", count);
+
+            list<int64> extremal;
+            if (terms > 64) {
+                const int64 half = (terms + 1)/2;
+                vector<double> scratch(half);
+                list<double> prior;
+                parksdesign(
+                    scratch.data(), prior, odd ? 2*half - 1 : 2*half,
+                    bands, edges, gains, weights, density, pool
+                );
+                parksscale(extremal, prior, terms, grid, starts);
+            } else {
+                for (int64 kk = 0; kk <= terms; kk++) {
+                    extremal.append(kk*(size - 1)/terms);
+                }
+            }
+
+            const double worst = parksremez(
+                coefs, extremal, terms, max(density/4, (int64)1), grid, starts, pool
+            );
+            extremes.clear();
+            for (int64 kk = 0; kk <= terms; kk++) {
+                extremes.append(grid[extremal[kk]].ff);
+            }
+            return worst;
+        }
+
+    }
+
+    //
+    // Equiripple linear phase FIR design with the Parks-McClellan (Remez
+    // exchange) algorithm.  Band k runs from edges[2*k] to edges[2*k + 1],
+    // as fractions of Nyquist from 0.0 to 1.0, and the desired gain goes in
+    // a straight line from gains[2*k] to gains[2*k + 1] across it.  The
+    // error in band k is multiplied by weights[k], so a stop band weighted
+    // 10 times the pass band gets a tenth of the ripple.  The count taps
+    // are symmetric, and an even count always has a zero at Nyquist.  The
+    // return value is the largest weighted error of the final taps on the
+    // grid, which is the ripple of a band with a weight of one.
+    //
+    // The grid has density points per ripple plus the band edges, and the
+    // error on it comes from the barycentric form of the interpolating
+    // polynomial, so nothing ever solves a linear system.  It stops when the
+    // largest error on the grid is within 1e-4 of the ripple on the
+    // extremal set, or the set doesn't change.  Long filters start from the
+    // extremal set of one with half the taps, which leaves only a few
+    // iterations at full size, and the taps come from an FFT of the final
+    // polynomial.
+    //
+    // Asking for more taps than the bands need can push the ripple below
+    // what double precision can hold, somewhere past 1e-9 or so depending
+    // on the transition bands.  That fails with check() rather than
+    // returning taps that don't do what the return value says.
+    //
+    static inline double firparks(
+        double* taps, int64 count, int64 bands, const double* edges,
+        const double* gains, const double* weights, threadpool& pool,
+        int64 density=16
+    ) {
+        using namespace internal;
+        check(count >= 1, "need at least one tap");
+        check(bands >= 1, "need at least one band");
+        check(density >= 2, "need a grid density of at least 2");
+        for (int64 ii = 0; ii<2*bands; ii++) {
+            check(edges[ii] >= 0 && edges[ii] <= 1, "band edges must be 0.0 to 1.0");
+            check(ii == 0 || edges[ii] >= edges[ii - 1], "band edges must increase");
+            check(ii%2 == 1 || ii == 0 || edges[ii] > edges[ii - 1], "bands can't touch");
+        }
+        for (int64 ii = 0; ii<bands; ii++) {
+            check(weights[ii] > 0, "band weights must be positive");
+        }
+
+        const bool odd = count%2 == 1;
+        const int64 terms = odd ? (count + 1)/2 : count/2;
+        vector<double> coefs(terms);
+        list<double> extremes;
+        const double worst = parksdesign(
+            coefs.data(), extremes, count, bands, edges, gains, weights,
+            density, pool
+        );
+
+        // cosine series to taps, centered in the middle
+        if (odd) {
+            const int64 mid = terms - 1;
+            taps[mid] = coefs[0];
+            for (int64 kk = 1; kk<terms; kk++) {
+                taps[mid - kk] = taps[mid + kk] = coefs[kk];
+            }
+        } else {
+            // cos(w/2)*cos(k*w) = (cos((k + 1/2)*w) + cos((k - 1/2)*w))/2
+            const int64 mid = terms;
+            for (int64 kk = 0; kk<terms; kk++) {
+                const double here = kk == 0 ? coefs[0] : 2*coefs[kk];
+                const double next = kk + 1 < terms ? 2*coefs[kk + 1] : 0;
+                const double tap = kk == 0 ? (here + next/2)/2 : (here + next)/4;
+                taps[mid - 1 - kk] = taps[mid + kk] = tap;
+            }
+        }
+
+        return worst;
+    }
+
+}
+
+#endif // XM_FIRPARKS_H_
@@ -0,0 +1,264 @@
+#ifndef XM_HALFBAND_H_
+#define XM_HALFBAND_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "list.h"
+#include "vector.h"
+#include "firwin.h"
+
+namespace xm {
+
+    //
+    // Halfband lowpass and decimate by 2.  A halfband filter is a windowed
+    // sinc(x/2), so every other tap is zero except the center one, which is
+    // exactly 1/2.  Output m is centered on input 2*m, so it only needs the
+    // center sample and the odd samples around it:
+    //
+    //     y[m] = x[2m]/2 + sum over j of g[j]*x[2m - span + 2j]
+    //
+    // The odd samples are copied into a contiguous buffer once, then the
+    // inner loop does two outputs per f32x4 against a broadcast tap, so
+    // there's no shuffling and no horizontal sums.  Only the outputs that
+    // are kept are computed.
+    //
+    // This is a streaming filter: the input can be given in any size pieces,
+    // and flush() produces the last outputs (treating the input as zero
+    // after the end).  The outputs are not delayed, output m always lines up
+    // with input 2*m, and there are (count + 1)/2 outputs in total.
+    //
+    struct halfband {
+        //~halfband() = default;
+        //halfband() = default;
+        //halfband(const halfband&) = default;
+        //halfband& operator =(const halfband&) = default;
+
+        // transition is the width of the transition band as a fraction of
+        // the input rate, from the passband edge to its alias at .5 - edge
+        inline halfband(int window, double transition);
+
+        // Consumes len inputs, writes to dst, and returns how many outputs
+        // were written.  That's never more than (len + 1)/2 + 1.
+        inline int64 apply(cfloat* dst, const cfloat* src, int64 len);
+
+        // Writes the remaining outputs and returns how many there were.
+        // That's never more than muls().
+        inline int64 flush(cfloat* dst);
+
+        // The number of odd taps on each side of the center
+        inline int64 muls() const;
+
+        private:
+            enum { chunk = 4096 };
+            int64 span;            // offset of the outermost taps
+            int64 have;            // samples in pending
+            int64 total;           // inputs consumed so far
+            int64 written;         // outputs produced so far
+            vector<float> taps;    // the odd taps, each broadcast 4 times
+            vector<cfloat> pending;
+            vector<cfloat> odd;
+
+            inline int64 run(cfloat* dst, int64 count);
+    };
+
+    //
+    // The odd taps of a halfband, from the outside in, scaled to sum to 1/2
+    // so the gain at DC is exactly 1 with the center tap.  The length is
+    // picked from the window and the transition width (as a fraction of the
+    // input rate).  Empirically, this gets the most out of each window.
+    //
+    static inline vector<double> halfodds(int window, double transition) {
+        check(transition > 0 && transition <= .5, "transition must be in (0, .5]");
+        const int64 count = (int64)ceil(3*apodize(window)/(4*transition));
+        const int64 span = 2*count - 1;
+        const int64 length = 2*span + 1;
+        vector<double> odds(2*count);
+        double sum = 0;
+        for (int64 jj = 0; jj<2*count; jj++) {
+            double xx = 2*jj - span;
+            odds[jj] = sinc(.5*xx)*firwin(window, xx, length + 1);
+            sum += odds[jj];
+        }
+        for (int64 jj = 0; jj<2*count; jj++) {
+            odds[jj] *= .5/sum;
+        }
+        return odds;
+    }
+
+    halfband::halfband(int window, double transition) : have(0), total(0), written(0) {
+        vector<double> odds = halfodds(window, transition);
+        span = odds.size() - 1;
+        taps.resize(4*odds.size());
+        for (int64 jj = 0; jj<odds.size(); jj++) {
+            for (int64 kk = 0; kk<4; kk++) {
+                taps[4*jj + kk] = odds[jj];
+            }
+        }
+
+        // the pending samples start with zeros before the first input, and
+        // a flush reads up to span past the last of as many as 2*span left
+        pending.resize(3*span + chunk + 1, cfloat(0, 0));
+        odd.resize((pending.size() + 1)/2 + 1);
+        have = span;
+    }
+
+    int64 halfband::muls() const {
+        return (span + 1)/2;
+    }
+
+    int64 halfband::run(cfloat* dst, int64 count) {
+        // pending[span + 2*m] is the center of output m, and the odd
+        // samples for it start at pending[2*m]
+        const int64 width = span + 1;
+        cfloat* ob = odd.data();
+        for (int64 ii = 0; ii<count + span; ii++) {
+            ob[ii] = pending[2*ii];
+        }
+
+        const float* gg = taps.data();
+        const float* oo = (const float*)ob;
+        int64 mm = 0;
+        for (; mm + 4 <= count; mm += 4) {
+            f32x4 acc0 = { 0, 0, 0, 0 };
+            f32x4 acc1 = { 0, 0, 0, 0 };
+            for (int64 jj = 0; jj<width; jj++) {
+                f32x4 tap = simdload<f32x4>(gg + 4*jj);
+                acc0 += simdload<f32x4>(oo + 2*(mm + jj) + 0)*tap;
+                acc1 += simdload<f32x4>(oo + 2*(mm + jj) + 4)*tap;
+            }
+            simdstore((float*)(dst + mm) + 0, acc0);
+            simdstore((float*)(dst + mm) + 4, acc1);
+        }
+        for (; mm < count; mm++) {
+            cfloat acc(0, 0);
+            for (int64 jj = 0; jj<width; jj++) {
+                acc += ob[mm + jj]*gg[4*jj];
+            }
+            dst[mm] = acc;
+        }
+        for (mm = 0; mm < count; mm++) {
+            dst[mm] += pending[span + 2*mm]*.5f;
+        }
+
+        // keep what the next outputs still need
+        have -= 2*count;
+        for (int64 ii = 0; ii<have; ii++) {
+            pending[ii] = pending[2*count + ii];
+        }
+        written += count;
+        return count;
+    }
+
+    int64 halfband::apply(cfloat* dst, const cfloat* src, int64 len) {
+        int64 result = 0;
+        while (len > 0) {
+            int64 amt = min(len, (int64)chunk);
+            for (int64 ii = 0; ii<amt; ii++) {
+                pending[have + ii] = src[ii];
+            }
+            have += amt;
+            total += amt;
+            src += amt;
+            len -= amt;
+
+            // output m needs pending up to span + 2*m + span
+            int64 count = have > 2*span ? (have - 2*span + 1)/2 : 0;
+            result += run(dst + result, count);
+        }
+        return result;
+    }
+
+    int64 halfband::flush(cfloat* dst) {
+        int64 count = (total + 1)/2 - written;
+        for (int64 ii = have; ii<(int64)pending.size(); ii++) {
+            pending[ii] = cfloat(0, 0);
+        }
+        return run(dst, count);
+    }
+
+    //
+    // Decimates by 2**stages with a chain of halfbands.  Only the last stage
+    // needs the sharp transition for percent of the output band, the earlier
+    // ones just have to keep aliases out of that band, so they get wider
+    // transitions and fewer taps.
+    //
+    struct halfcascade {
+        inline ~halfcascade();
+        inline halfcascade(int window, double percent, int64 stages);
+
+        // Same as halfband, with at most len/2**stages + stages outputs
+        inline int64 apply(cfloat* dst, const cfloat* src, int64 len);
+        inline int64 flush(cfloat* dst);
+
+        private:
+            halfcascade(const halfcascade&); // deleted
+            halfcascade& operator =(const halfcascade&); // deleted
+
+            list<halfband*> chain;
+            list<vector<cfloat> > buffers;
+            inline int64 pass(int64 first, cfloat* dst, const cfloat* src, int64 len);
+    };
+
+    halfcascade::~halfcascade() {
+        for (int64 ii = 0; ii<chain.size(); ii++) {
+            delete chain[ii];
+        }
+    }
+
+    halfcascade::halfcascade(int window, double percent, int64 stages) {
+        check(stages >= 1, "need at least one stage (%lld)", stages);
+        check(percent > 0 && percent < 100, "percent must be in (0, 100)");
+        for (int64 ii = 0; ii<stages; ii++) {
+            // the band we keep is this narrow relative to the stage's input
+            double edge = percent*.0025/(1LL << (stages - 1 - ii));
+            chain.append(new halfband(window, .5 - 2*edge));
+            buffers.append(vector<cfloat>());
+        }
+    }
+
+    int64 halfcascade::pass(int64 first, cfloat* dst, const cfloat* src, int64 len) {
+        // each stage works through its input a piece at a time so the
+        // buffers between stages stay small
+        int64 result = 0;
+        const int64 last = chain.size() - 1;
+        vector<cfloat>& buffer = buffers[first];
+        if (buffer.size() == 0) buffer.resize(8192 + 4);
+        while (len > 0) {
+            int64 amt = min(len, 16384);
+            if (first == last) {
+                result += chain[first]->apply(dst + result, src, amt);
+            } else {
+                int64 got = chain[first]->apply(buffer.data(), src, amt);
+                result += pass(first + 1, dst + result, buffer.data(), got);
+            }
+            src += amt;
+            len -= amt;
+        }
+        return result;
+    }
+
+    int64 halfcascade::apply(cfloat* dst, const cfloat* src, int64 len) {
+        return pass(0, dst, src, len);
+    }
+
+    int64 halfcascade::flush(cfloat* dst) {
+        int64 result = 0;
+        const int64 last = chain.size() - 1;
+        for (int64 ii = 0; ii<last; ii++) {
+            vector<cfloat>& buffer = buffers[ii];
+            const int64 need = max((int64)8192 + 4, chain[ii]->muls());
+            if (buffer.size() < need) buffer.resize(need);
+            int64 got = chain[ii]->flush(buffer.data());
+            result += pass(ii + 1, dst + result, buffer.data(), got);
+        }
+        result += chain[last]->flush(dst + result);
+        return result;
+    }
+
+}
+
+#endif // XM_HALFBAND_H_
+
@@ -1,6 +1,15 @@
 #ifndef KISSFFT_H_
 #define KISSFFT_H_
 
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "list.h"
+#include "vector.h"
+#include "parallel.h"
+
 namespace xm {
 
     //{{{ kissfft
@@ -45,51 +54,470 @@ namespace xm {
     //    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     //
     //}}}
+    namespace internal {
+        template<class type> struct bluestein;
+    }
+
     template<class type>
     struct kissfft {
         kissfft(int64 samples, bool inverse=false);
 
+        // Power of 2 sizes of float and double use the iterative SIMD
+        // path below (which can also work in place), and everything else
+        // uses the recursive KISS FFT.  This uses scratch space inside the
+        // plan, so only one thread at a time can call it.
         void exec(complex<type>* dst, const complex<type>* src) const;
 
+        // The same, with the caller's scratch space of scratch_size()
+        // elements.  The plan is only read, so threads can share it.
+        void exec(complex<type>* dst, const complex<type>* src, complex<type>* scratch) const;
+        int64 scratch_size() const;
+
+        // Runs count transforms, where transform k reads src[k*distance +
+        // i*stride] and writes dst at the same places, split across the
+        // threads in the pool.
+        void batch(
+            complex<type>* dst, const complex<type>* src,
+            int64 count, int64 stride, int64 distance, threadpool& pool
+        ) const;
+
+        // Always uses the recursive KISS FFT (for testing and benchmarks)
+        void exec_generic(complex<type>* dst, const complex<type>* src) const;
+
         private:
             void work(
                 complex<type>* dst, const complex<type>* src,
-                int64 fstride, int64 istride, const int64* factptr
+                int64 fstride, int64 istride, const int64* factptr,
+                complex<type>* buffer
             ) const;
 
             void bfly2(complex<type>* dst, int64 fstride, int64 mm) const;
             void bfly3(complex<type>* dst, int64 fstride, int64 mm) const;
             void bfly4(complex<type>* dst, int64 fstride, int64 mm) const;
             void bfly5(complex<type>* dst, int64 fstride, int64 mm) const;
-            void bflyn(complex<type>* dst, int64 fstride, int64 mm, int64 pp) const;
+            void bflyn(
+                complex<type>* dst, int64 fstride, int64 mm, int64 pp,
+                complex<type>* buffer
+            ) const;
 
             bool inverse;
             list<int64> factors;
             vector<complex<type> > twiddles;
             mutable vector<complex<type> > scratch;
+            int64 needed;
+
+            // twiddles for each radix 4 stage of the SIMD path, empty
+            // when the size or type doesn't use it
+            vector<complex<type> > stages;
+
+            // plans for large prime factors, see internal::bluestein
+            list<internal::bluestein<type> > chirps;
     };
 
     namespace internal {
         template<class type> type spread(double val);
 
-        template<> float spread<float>(double val) {
+        template<> inline float spread<float>(double val) {
             return (float)val;
         }
 
-        template<> double spread<double>(double val) {
+        template<> inline double spread<double>(double val) {
             return val;
         }
 
-        template<> deprecated::f32x4 spread<deprecated::f32x4>(double dd) {
+        template<> inline f32x4 spread<f32x4>(double dd) {
             float ff = (float)dd;
-            return (deprecated::f32x4){ ff, ff, ff, ff };
+            return (f32x4){ ff, ff, ff, ff };
         }
 
-        template<> deprecated::f64x2 spread<deprecated::f64x2>(double dd) {
-            return (deprecated::f64x2){ dd, dd };
+        template<> inline f64x2 spread<f64x2>(double dd) {
+            return (f64x2){ dd, dd };
         }
     }
 
+    namespace internal {
+        //{{{ fftvec
+
+        //
+        // The SIMD operations for the iterative FFT.  A vec holds per complex
+        // numbers interleaved, and a twiddle holds one complex number split
+        // for multiplying the same way as in blocktuner: real parts
+        // duplicated and the sign folded into the imaginary parts.  Types
+        // without a specialization have per = 0 and don't use the SIMD path.
+        //
+        template<class type>
+        struct fftvec {
+            enum { per = 0 };
+        };
+
+        template<>
+        struct fftvec<float> {
+            enum { per = 2 };
+            typedef f32x4 vec;
+            struct twiddle { f32x4 re, im; };
+
+            static inline vec load(const complex<float>* ptr) {
+                return simdload<f32x4>((const float*)ptr);
+            }
+            static inline void store(complex<float>* ptr, const vec& val) {
+                simdstore((float*)ptr, val);
+            }
+            static inline twiddle split(const complex<float>& ww) {
+                twiddle tt = {
+                    { ww.re, ww.re, ww.re, ww.re },
+                    { -ww.im, ww.im, -ww.im, ww.im }
+                };
+                return tt;
+            }
+            // two different twiddles, one for each complex in a vec
+            static inline twiddle split2(const complex<float>* ww) {
+                const f32x4 sign = { -1, 1, -1, 1 };
+                f32x4 both = simdload<f32x4>((const float*)ww);
+                twiddle tt = {
+                    __builtin_shuffle(both, (i32x4){ 0, 0, 2, 2 }),
+                    __builtin_shuffle(both, (i32x4){ 1, 1, 3, 3 })*sign
+                };
+                return tt;
+            }
+            static inline vec mul(const vec& xx, const twiddle& tt) {
+                return xx*tt.re + __builtin_shuffle(xx, (i32x4){ 1, 0, 3, 2 })*tt.im;
+            }
+            // multiply by +j (or -j for the inverse)
+            static inline vec rot(const vec& xx, bool inverse) {
+                const f32x4 fwd = { -1, 1, -1, 1 };
+                const f32x4 inv = { 1, -1, 1, -1 };
+                return __builtin_shuffle(xx, (i32x4){ 1, 0, 3, 2 })*(inverse ? inv : fwd);
+            }
+            // first and second complex from each of two vecs
+            static inline vec lows(const vec& aa, const vec& bb) {
+                return __builtin_shuffle(aa, bb, (i32x4){ 0, 1, 4, 5 });
+            }
+            static inline vec highs(const vec& aa, const vec& bb) {
+                return __builtin_shuffle(aa, bb, (i32x4){ 2, 3, 6, 7 });
+            }
+        };
+
+        template<>
+        struct fftvec<double> {
+            enum { per = 1 };
+            typedef f64x2 vec;
+            struct twiddle { f64x2 re, im; };
+
+            static inline vec load(const complex<double>* ptr) {
+                return simdload<f64x2>((const double*)ptr);
+            }
+            static inline void store(complex<double>* ptr, const vec& val) {
+                simdstore((double*)ptr, val);
+            }
+            static inline twiddle split(const complex<double>& ww) {
+                twiddle tt = { { ww.re, ww.re }, { -ww.im, ww.im } };
+                return tt;
+            }
+            static inline twiddle split2(const complex<double>* ww) {
+                return split(*ww);
+            }
+            static inline vec mul(const vec& xx, const twiddle& tt) {
+                return xx*tt.re + __builtin_shuffle(xx, (i64x2){ 1, 0 })*tt.im;
+            }
+            static inline vec rot(const vec& xx, bool inverse) {
+                const f64x2 fwd = { -1, 1 };
+                const f64x2 inv = { 1, -1 };
+                return __builtin_shuffle(xx, (i64x2){ 1, 0 })*(inverse ? inv : fwd);
+            }
+            static inline vec lows(const vec& aa, const vec&) { return aa; }
+            static inline vec highs(const vec& aa, const vec&) { return aa; }
+        };
+
+        //}}}
+        //{{{ bluestein
+
+        //
+        // Large prime factors are done as a convolution with a chirp
+        // (Bluestein's algorithm) using the SIMD path, which makes them
+        // O(p log p) instead of O(p**2).  Each p point DFT is
+        //
+        //     X[k] = chirp[k] * sum over n of (x[n]*chirp[n]) * conj(chirp[k - n])
+        //
+        // since n*k = (n*n + k*k - (k - n)**2)/2, and the sum is a circular
+        // convolution, zero padded to a power of 2.
+        //
+        template<class type>
+        struct bluestein {
+            enum { threshold = 13 };  // faster than bflyn above this
+            bluestein() : primes(0), length(0) {}
+            int64 primes;
+            int64 length;
+            vector<complex<type> > chirp;
+            vector<complex<type> > filter;   // transform of conj(chirp)
+            vector<complex<type> > stages;   // forward twiddles of length
+        };
+
+        //}}}
+        //{{{ stockham
+
+        //
+        // Iterative Stockham FFT for powers of 2.  Each radix 4 stage reads
+        // x and writes y (then they swap), and the output order sorts itself
+        // out, so there's no bit reversal pass.  In a stage of length len and
+        // stride ss, the inner loop runs over ss contiguous complex numbers
+        // that all share the same twiddles, so it's plain SIMD arithmetic.
+        // The first stage has a stride of one, so there the loop runs over
+        // pairs of butterflies instead.  A length of 2 is left at the end for
+        // an odd power of 2, which is a radix 2 stage without twiddles.
+        //
+        template<class type, bool simd=(fftvec<type>::per > 0)>
+        struct stockham {
+            static bool usable(int64) { return false; }
+            static void plan(vector<complex<type> >&, int64, bool, const complex<type>* =0) {}
+            static int64 count(int64) { return 0; }
+            static void chirp(bluestein<type>&, int64, bool) {}
+            static void chirpn(
+                complex<type>*, int64, int64, const bluestein<type>&,
+                const vector<complex<type> >&, complex<type>*
+            ) {}
+            static void exec(
+                complex<type>*, const complex<type>*, complex<type>*,
+                int64, const complex<type>*, bool
+            ) {}
+        };
+
+        template<class type>
+        struct stockham<type, true> {
+            typedef fftvec<type> ops;
+            typedef typename ops::vec vec;
+            typedef typename ops::twiddle twiddle;
+
+            // sizes the iterative path handles
+            static bool usable(int64 size) {
+                return size >= 4*ops::per && (size & (size - 1)) == 0;
+            }
+
+            // The twiddles for each radix 4 stage, picked from the table of
+            // all size twiddles if there is one
+            static void plan(
+                vector<complex<type> >& stages, int64 size, bool inverse,
+                const complex<type>* table=0
+            ) {
+                int64 total = 0;
+                for (int64 len = size; len >= 4; len /= 4) {
+                    total += 3*(len/4);
+                }
+                stages.resize(total);
+                int64 index = 0;
+                for (int64 len = size; len >= 4; len /= 4) {
+                    for (int64 kk = 1; kk <= 3; kk++) {
+                        for (int64 jj = 0; jj<len/4; jj++) {
+                            if (table) {
+                                stages[index++] = table[kk*jj*(size/len)];
+                                continue;
+                            }
+                            double phase = -2*M_PI*kk*jj/len;
+                            if (inverse) phase *= -1;
+                            stages[index].re = spread<type>(::cos(phase));
+                            stages[index].im = spread<type>(::sin(phase));
+                            index++;
+                        }
+                    }
+                }
+            }
+
+            // number of passes over the data
+            static int64 count(int64 size) {
+                int64 stages = 0;
+                for (int64 len = size; len > 1; len /= 4) {
+                    stages++;
+                    if (len == 2) break;
+                }
+                return stages;
+            }
+
+            static void radix4(
+                complex<type>* yy, const complex<type>* xx, int64 len, int64 ss,
+                const complex<type>* tw, bool inverse
+            ) {
+                const int64 quarter = len/4;
+                const complex<type>* tw1 = tw;
+                const complex<type>* tw2 = tw + quarter;
+                const complex<type>* tw3 = tw + 2*quarter;
+                for (int64 pp = 0; pp<quarter; pp++) {
+                    const twiddle t1 = ops::split(tw1[pp]);
+                    const twiddle t2 = ops::split(tw2[pp]);
+                    const twiddle t3 = ops::split(tw3[pp]);
+                    const complex<type>* x0 = xx + ss*pp;
+                    const complex<type>* x1 = x0 + ss*quarter;
+                    const complex<type>* x2 = x1 + ss*quarter;
+                    const complex<type>* x3 = x2 + ss*quarter;
+                    complex<type>* y0 = yy + ss*4*pp;
+                    complex<type>* y1 = y0 + ss;
+                    complex<type>* y2 = y1 + ss;
+                    complex<type>* y3 = y2 + ss;
+                    for (int64 qq = 0; qq<ss; qq += ops::per) {
+                        vec aa = ops::load(x0 + qq);
+                        vec bb = ops::load(x1 + qq);
+                        vec cc = ops::load(x2 + qq);
+                        vec dd = ops::load(x3 + qq);
+                        vec apc = aa + cc;
+                        vec amc = aa - cc;
+                        vec bpd = bb + dd;
+                        vec jbmd = ops::rot(bb - dd, inverse);
+                        ops::store(y0 + qq, apc + bpd);
+                        ops::store(y1 + qq, ops::mul(amc - jbmd, t1));
+                        ops::store(y2 + qq, ops::mul(apc - bpd, t2));
+                        ops::store(y3 + qq, ops::mul(amc + jbmd, t3));
+                    }
+                }
+            }
+
+            // the first stage, with a stride of one
+            static void first4(
+                complex<type>* yy, const complex<type>* xx, int64 len,
+                const complex<type>* tw, bool inverse
+            ) {
+                const int64 quarter = len/4;
+                const complex<type>* tw1 = tw;
+                const complex<type>* tw2 = tw + quarter;
+                const complex<type>* tw3 = tw + 2*quarter;
+                for (int64 pp = 0; pp<quarter; pp += ops::per) {
+                    vec aa = ops::load(xx + pp);
+                    vec bb = ops::load(xx + pp + quarter);
+                    vec cc = ops::load(xx + pp + 2*quarter);
+                    vec dd = ops::load(xx + pp + 3*quarter);
+                    vec apc = aa + cc;
+                    vec amc = aa - cc;
+                    vec bpd = bb + dd;
+                    vec jbmd = ops::rot(bb - dd, inverse);
+                    vec r0 = apc + bpd;
+                    vec r1 = ops::mul(amc - jbmd, ops::split2(tw1 + pp));
+                    vec r2 = ops::mul(apc - bpd, ops::split2(tw2 + pp));
+                    vec r3 = ops::mul(amc + jbmd, ops::split2(tw3 + pp));
+                    // outputs 4*pp + k, interleaved back from the pairs
+                    complex<type>* out = yy + 4*pp;
+                    if (ops::per == 1) {
+                        ops::store(out + 0, r0);
+                        ops::store(out + 1, r1);
+                        ops::store(out + 2, r2);
+                        ops::store(out + 3, r3);
+                    } else {
+                        ops::store(out + 0, ops::lows(r0, r1));
+                        ops::store(out + 2, ops::lows(r2, r3));
+                        ops::store(out + 4, ops::highs(r0, r1));
+                        ops::store(out + 6, ops::highs(r2, r3));
+                    }
+                }
+            }
+
+            static void last2(complex<type>* yy, const complex<type>* xx, int64 ss) {
+                for (int64 qq = 0; qq<ss; qq += ops::per) {
+                    vec aa = ops::load(xx + qq);
+                    vec bb = ops::load(xx + qq + ss);
+                    ops::store(yy + qq, aa + bb);
+                    ops::store(yy + qq + ss, aa - bb);
+                }
+            }
+
+            // size must be a power of 2 that's at least 4*per
+            static void exec(
+                complex<type>* dst, const complex<type>* src, complex<type>* tmp,
+                int64 size, const complex<type>* tw, bool inverse
+            ) {
+                // alternate buffers so the last stage writes dst
+                const int64 stages = count(size);
+                complex<type>* bufs[2] = { dst, tmp };
+                int64 which = stages%2 ? 0 : 1;
+
+                int64 len = size;
+                int64 ss = 1;
+                const complex<type>* xx = src;
+                while (len > 1) {
+                    complex<type>* yy = bufs[which];
+                    if (len == 2) {
+                        last2(yy, xx, ss);
+                        break;
+                    }
+                    if (ss == 1) first4(yy, xx, len, tw, inverse);
+                    else radix4(yy, xx, len, ss, tw, inverse);
+                    tw += 3*(len/4);
+                    xx = yy;
+                    which ^= 1;
+                    len /= 4;
+                    ss *= 4;
+                }
+            }
+
+            static void chirp(bluestein<type>& plan, int64 pp, bool inverse) {
+                plan.primes = pp;
+                plan.length = 1;
+                while (plan.length < 2*pp - 1) plan.length *= 2;
+                const int64 ll = plan.length;
+
+                // chirp[n] = W**(n*n/2), with n*n reduced to keep the phase exact
+                plan.chirp.resize(pp);
+                for (int64 nn = 0; nn<pp; nn++) {
+                    double phase = -M_PI*((nn*nn)%(2*pp))/pp;
+                    if (inverse) phase *= -1;
+                    plan.chirp[nn].re = spread<type>(::cos(phase));
+                    plan.chirp[nn].im = spread<type>(::sin(phase));
+                }
+
+                // the transform of conj(chirp) at both ends, with the 1/length
+                // for the inverse transform folded in
+                stockham::plan(plan.stages, ll, false);
+                vector<complex<type> > wrapped(ll, complex<type>(0, 0));
+                wrapped[0] = conj(plan.chirp[0]);
+                for (int64 nn = 1; nn<pp; nn++) {
+                    wrapped[nn] = wrapped[ll - nn] = conj(plan.chirp[nn]);
+                }
+                vector<complex<type> > tmp(ll);
+                plan.filter.resize(ll);
+                exec(plan.filter.data(), wrapped.data(), tmp.data(), ll, plan.stages.data(), false);
+                const type scale = spread<type>(1.0/ll);
+                for (int64 kk = 0; kk<ll; kk++) {
+                    plan.filter[kk] = plan.filter[kk]*scale;
+                }
+            }
+
+            // The same butterflies as kissfft::bflyn.  The inverse FFT for
+            // the convolution is conj(FFT(conj(X))), so only forward stages
+            // are needed.
+            static void chirpn(
+                complex<type>* dst, int64 fstride, int64 mm, const bluestein<type>& plan,
+                const vector<complex<type> >& twiddles, complex<type>* buffer
+            ) {
+                const int64 pp = plan.primes;
+                const int64 ll = plan.length;
+                complex<type>* aa = buffer;
+                complex<type>* bb = aa + ll;
+                complex<type>* tmp = bb + ll;
+                const int64 Norig = twiddles.size();
+
+                for (int64 uu = 0; uu < mm; ++uu) {
+                    // twiddle for this butterfly, and then the chirp
+                    int64 twidx = 0;
+                    for (int64 nn = 0; nn<pp; nn++) {
+                        aa[nn] = dst[uu + nn*mm]*twiddles[twidx]*plan.chirp[nn];
+                        twidx += fstride*uu;
+                        if (twidx >= Norig) twidx -= Norig;
+                    }
+                    for (int64 nn = pp; nn<ll; nn++) {
+                        aa[nn] = complex<type>(0, 0);
+                    }
+
+                    exec(bb, aa, tmp, ll, plan.stages.data(), false);
+                    for (int64 kk = 0; kk<ll; kk++) {
+                        bb[kk] = conj(bb[kk]*plan.filter[kk]);
+                    }
+                    exec(aa, bb, tmp, ll, plan.stages.data(), false);
+
+                    for (int64 kk = 0; kk<pp; kk++) {
+                        dst[uu + kk*mm] = conj(aa[kk])*plan.chirp[kk];
+                    }
+                }
+            }
+        };
+
+        //}}}
+    }
+
     //{{{ constructor
     template<class type>
     kissfft<type>::kissfft(int64 nn, bool inv) : inverse(inv), twiddles(nn) {
@@ -117,19 +545,143 @@ namespace xm {
             factors.append(pp);
             factors.append(nn);
         } while (nn > 1);
+
+        // the per stage twiddles for the iterative path
+        const int64 size = twiddles.size();
+        needed = 0;
+        if (internal::stockham<type>::usable(size)) {
+            internal::stockham<type>::plan(stages, size, inv, twiddles.data());
+            needed = size;
+        }
+
+        // and the chirps for large primes
+        for (int64 ii = 0; ii<factors.size(); ii += 2) {
+            const int64 primes = factors[ii];
+            if (primes <= internal::bluestein<type>::threshold) continue;
+            if (internal::fftvec<type>::per == 0) continue;
+            bool found = false;
+            for (int64 jj = 0; jj<chirps.size(); jj++) {
+                if (chirps[jj].primes == primes) found = true;
+            }
+            if (found) continue;
+            chirps.append(internal::bluestein<type>());
+            internal::stockham<type>::chirp(chirps[chirps.size() - 1], primes, inv);
+        }
+
+        // bflyn needs a copy of its inputs, or three convolution buffers
+        for (int64 ii = 0; ii<factors.size(); ii += 2) {
+            needed = max(needed, factors[ii]);
+        }
+        for (int64 ii = 0; ii<chirps.size(); ii++) {
+            needed = max(needed, 3*chirps[ii].length);
+        }
+        scratch.resize(needed);
     }
     //}}}
     //{{{ exec and work
     template<class type>
     void kissfft<type>::exec(complex<type>* dst, const complex<type>* src) const {
-        work(dst, src, 1, 1, factors.data());
+        exec(dst, src, scratch.data());
+    }
+
+    template<class type>
+    void kissfft<type>::exec(
+        complex<type>* dst, const complex<type>* src, complex<type>* buffer
+    ) const {
+        if (stages.size() == 0) {
+            work(dst, src, 1, 1, factors.data(), buffer);
+            return;
+        }
+
+        const int64 size = twiddles.size();
+        if (dst == src && internal::stockham<type>::count(size)%2) {
+            // the first stage writes to dst, so it reads a copy
+            for (int64 ii = 0; ii<size; ii++) buffer[ii] = src[ii];
+            internal::stockham<type>::exec(
+                dst, buffer, buffer, size, stages.data(), inverse
+            );
+            return;
+        }
+        internal::stockham<type>::exec(
+            dst, src, buffer, size, stages.data(), inverse
+        );
+    }
+
+    template<class type>
+    int64 kissfft<type>::scratch_size() const {
+        return needed;
+    }
+
+    namespace internal {
+        // Each index does a contiguous share of the transforms with its own
+        // piece of the scratch space.  Strided data is gathered into a
+        // contiguous buffer first, and so is anything in place that the
+        // recursive code would have to do.
+        template<class type>
+        struct fftbatch {
+            const kissfft<type>* plan;
+            complex<type>* dst;
+            const complex<type>* src;
+            complex<type>* scratch;
+            int64 size, count, stride, distance, share, each;
+            bool copy;
+
+            void operator ()(int64 index) {
+                const int64 lo = index*share;
+                const int64 hi = min(lo + share, count);
+                complex<type>* buffer = scratch + index*each;
+                complex<type>* gather = buffer + plan->scratch_size();
+                complex<type>* result = gather + size;
+                for (int64 kk = lo; kk<hi; kk++) {
+                    const complex<type>* ss = src + kk*distance;
+                    complex<type>* dd = dst + kk*distance;
+                    if (!copy) {
+                        plan->exec(dd, ss, buffer);
+                        continue;
+                    }
+                    for (int64 ii = 0; ii<size; ii++) gather[ii] = ss[ii*stride];
+                    plan->exec(result, gather, buffer);
+                    for (int64 ii = 0; ii<size; ii++) dd[ii*stride] = result[ii];
+                }
+            }
+        };
+    }
+
+    template<class type>
+    void kissfft<type>::batch(
+        complex<type>* dst, const complex<type>* src,
+        int64 count, int64 stride, int64 distance, threadpool& pool
+    ) const {
+        if (count <= 0) return;
+        const int64 size = twiddles.size();
+        const int64 shares = min(count, pool.size());
+        internal::fftbatch<type> job;
+        job.plan     = this;
+        job.dst      = dst;
+        job.src      = src;
+        job.size     = size;
+        job.count    = count;
+        job.stride   = stride;
+        job.distance = distance;
+        job.share    = (count + shares - 1)/shares;
+        job.copy     = stride != 1 || (dst == src && stages.size() == 0);
+        job.each     = needed + (job.copy ? 2*size : 0);
+        vector<complex<type> > scratch(max(1, shares*job.each));
+        job.scratch  = scratch.data();
+        pool.parfor(shares, job);
+    }
+
+    template<class type>
+    void kissfft<type>::exec_generic(complex<type>* dst, const complex<type>* src) const {
+        work(dst, src, 1, 1, factors.data(), scratch.data());
     }
 
 
     template<class type>
     void kissfft<type>::work(
         complex<type>* dst, const complex<type>* src,
-        int64 fstride, int64 istride, const int64* factptr
+        int64 fstride, int64 istride, const int64* factptr,
+        complex<type>* buffer
     ) const {
 
         complex<type> *dst_beg = dst;
@@ -144,7 +696,7 @@ namespace xm {
             } while (++dst != dst_end);
         } else {
             do {
-                work(dst, src, fstride * pp, istride, factptr);
+                work(dst, src, fstride * pp, istride, factptr, buffer);
                 src += fstride * istride;
             } while ((dst += mm) != dst_end);
         }
@@ -156,7 +708,7 @@ namespace xm {
             case  3: bfly3(dst, fstride, mm); break;
             case  4: bfly4(dst, fstride, mm); break;
             case  5: bfly5(dst, fstride, mm); break;
-            default: bflyn(dst, fstride, mm, pp); break;
+            default: bflyn(dst, fstride, mm, pp, buffer); break;
         }
     }
     //}}}
@@ -347,8 +899,18 @@ namespace xm {
     //}}}
     //{{{ bflyn
     template<class type>
-    void kissfft<type>::bflyn(complex<type>* dst, int64 fstride, int64 mm, int64 pp) const {
-        if (scratch.size() < pp) scratch.resize(pp);
+    void kissfft<type>::bflyn(
+        complex<type>* dst, int64 fstride, int64 mm, int64 pp,
+        complex<type>* scratch
+    ) const {
+        for (int64 ii = 0; ii<chirps.size(); ii++) {
+            if (chirps[ii].primes == pp) {
+                internal::stockham<type>::chirpn(
+                    dst, fstride, mm, chirps[ii], twiddles, scratch
+                );
+                return;
+            }
+        }
 
         int64 uu, kk, q1, qq;
         //const complex<type> *twiddles = st->twiddles;
@@ -381,6 +943,154 @@ namespace xm {
         }
     }
     //}}}
+    //}}}
+    //{{{ fftplan
+
+    //
+    // Plans shared across the whole process, built the first time each
+    // size and direction is asked for and kept until the process exits.
+    // Any thread can get one, but since a plan's own scratch space isn't
+    // safe to share, threads should call exec() with their own scratch.
+    //
+    template<class type>
+    const kissfft<type>& fftplan(int64 samples, bool inverse=false) {
+        static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        static list<int64> keys;
+        static list<kissfft<type>*> plans;
+
+        const int64 key = 2*samples + (inverse ? 1 : 0);
+        pthread_mutex_lock(&mutex);
+        for (int64 ii = 0; ii<keys.size(); ii++) {
+            if (keys[ii] == key) {
+                kissfft<type>* found = plans[ii];
+                pthread_mutex_unlock(&mutex);
+                return *found;
+            }
+        }
+
+        kissfft<type>* plan = 0;
+        try {
+            plan = new kissfft<type>(samples, inverse);
+        } catch (...) {
+            pthread_mutex_unlock(&mutex);
+            throw;
+        }
+        keys.append(key);
+        plans.append(plan);
+        pthread_mutex_unlock(&mutex);
+        return *plan;
+    }
+
+    //}}}
+    //{{{ realfft
+
+    //
+    // Real to complex (forward) and complex to real (inverse) transforms for
+    // an even number of samples.  The even and odd samples are packed as the
+    // real and imaginary parts of a half size complex FFT, and a pass with
+    // one more set of twiddles untangles the two halves:
+    //
+    //     X[k] = E[k] + W**k O[k]
+    //     E[k] = (Z[k] + conj(Z[N/2 - k]))/2
+    //     O[k] = (Z[k] - conj(Z[N/2 - k]))/2j
+    //
+    // The forward transform writes the N/2 + 1 non-negative frequencies, and
+    // the inverse reads them.  Like kissfft, neither one is scaled, so the
+    // inverse of the forward is N times the original.
+    //
+    template<class type>
+    struct realfft {
+        realfft(int64 samples, bool inverse=false);
+
+        // N reals to N/2 + 1 complex (forward only)
+        void exec(complex<type>* dst, const type* src) const;
+
+        // N/2 + 1 complex to N reals (inverse only)
+        void exec(type* dst, const complex<type>* src) const;
+
+        // The same with the caller's scratch space, like kissfft
+        void exec(complex<type>* dst, const type* src, complex<type>* scratch) const;
+        void exec(type* dst, const complex<type>* src, complex<type>* scratch) const;
+        int64 scratch_size() const;
+
+        private:
+            int64 samples;
+            bool inverse;
+            kissfft<type> half;
+            vector<complex<type> > twiddles;
+            mutable vector<complex<type> > scratch;
+    };
+
+    template<class type>
+    realfft<type>::realfft(int64 nn, bool inv) :
+        samples(nn), inverse(inv), half(nn/2, inv), twiddles(nn/2 + 1) {
+        check(nn >= 2 && nn%2 == 0, "realfft needs an even size (%lld)", nn);
+        for (int64 kk = 0; kk <= nn/2; kk++) {
+            double phase = -2*M_PI*kk/nn;
+            if (inv) phase *= -1;
+            twiddles[kk].re = internal::spread<type>(::cos(phase));
+            twiddles[kk].im = internal::spread<type>(::sin(phase));
+        }
+        scratch.resize(scratch_size());
+    }
+
+    template<class type>
+    int64 realfft<type>::scratch_size() const {
+        return samples/2 + half.scratch_size();
+    }
+
+    template<class type>
+    void realfft<type>::exec(complex<type>* dst, const type* src) const {
+        exec(dst, src, scratch.data());
+    }
+
+    template<class type>
+    void realfft<type>::exec(type* dst, const complex<type>* src) const {
+        exec(dst, src, scratch.data());
+    }
+
+    template<class type>
+    void realfft<type>::exec(
+        complex<type>* dst, const type* src, complex<type>* buffer
+    ) const {
+        check(!inverse, "realfft planned for the inverse");
+        const int64 nh = samples/2;
+        complex<type>* zz = buffer;
+        half.exec(zz, (const complex<type>*)src, buffer + nh);
+
+        const type mid = internal::spread<type>(0.5);
+        dst[0] = complex<type>(zz[0].re + zz[0].im);
+        dst[nh] = complex<type>(zz[0].re - zz[0].im);
+        for (int64 kk = 1; kk < nh; kk++) {
+            complex<type> aa = zz[kk];
+            complex<type> bb = conj(zz[nh - kk]);
+            complex<type> ee = aa + bb;
+            complex<type> oo = twiddles[kk]*(aa - bb);
+            // dividing by j is multiplying by -j
+            dst[kk].re = mid*(ee.re + oo.im);
+            dst[kk].im = mid*(ee.im - oo.re);
+        }
+    }
+
+    template<class type>
+    void realfft<type>::exec(
+        type* dst, const complex<type>* src, complex<type>* buffer
+    ) const {
+        check(inverse, "realfft planned for the forward");
+        const int64 nh = samples/2;
+        complex<type>* zz = buffer;
+        for (int64 kk = 0; kk < nh; kk++) {
+            complex<type> aa = src[kk];
+            complex<type> bb = conj(src[nh - kk]);
+            complex<type> ee = aa + bb;
+            complex<type> oo = twiddles[kk]*(aa - bb);
+            // Z[k] = E[k] + j*O[k], each twice as big to scale like N
+            zz[kk].re = ee.re - oo.im;
+            zz[kk].im = ee.im + oo.re;
+        }
+        half.exec((complex<type>*)dst, zz, buffer + nh);
+    }
+
     //}}}
 
     namespace deprecated {
@@ -2,48 +2,190 @@
 #define XM_MEDNOISE_H_ 1
 
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
 
 #include "basics.h"
 #include "complex.h"
 #include "vector.h"
+#include "compare.h"
+#include "sort.h"
 
 namespace xm {
 
-    static inline double mednoise(const cfloat* ptr, ssize_t len) {
-        // XXX: consider doing this with quickselect instead of a histogram
-
-        // Floating point values can have a max exponent of about 38, so ignoring
-        // denormals and infinities, the magsquare exponent can go from about -76
-        // to +76.  That's -760 to +760 dB.  We're doing a histogram of tenths of a
-        // dB, so -8000 to +8000 should cover the range more than adequately.
-        vector<ssize_t> histogram(16000, 0);
-        ssize_t ii;
-
-        for (ii = 0; ii<len; ii++) {
-            double m2 = mag2(ptr[ii]);
-            double db = 10.0*::log10(m2 + 1e-300);
-            double bin = floor(8000.0 + 10.0*db);
-            if (bin < 0) bin = 0;
-            if (bin > 15999) bin = 15999;
-            histogram[(ssize_t)bin]++;
-        }
-
-        ssize_t count = 0;
-        for (ii = 0; ii<16000; ii++) {
-            count += histogram[ii];
-            if (count >= len/2) {
-                double db = (ii + .5 - 8000)/10.0;
-                double median = ::pow(10.0, db/10);
-
-                // Returns linear power after converting the median to mean.
-                // Assumes the original data was complex normal, and so the
-                // the mag squared data is Chi-square with 2 degrees of freedom.
-                return median/::log(2.0);
+    namespace internal {
+
+        // The bits of a non-negative float sort the same way as its value,
+        // so the top bits are a log scale histogram bin without any log:
+        // the exponent picks the octave and the mantissa bits below it
+        // split that octave into linear steps.
+        static inline uint32_t floatbits(float ff) {
+            uint32_t bits;
+            memcpy(&bits, &ff, sizeof(bits));
+            return bits;
+        }
+
+        // A NaN can have the sign bit set, and clearing it keeps every
+        // power inside the tables, with inf and NaN at the very top
+        static inline uint32_t powerbits(const cfloat& sample) {
+            return floatbits(mag2(sample)) & 0x7fffffff;
+        }
+
+        static inline double bitsfloat(uint32_t bits) {
+            float ff;
+            memcpy(&ff, &bits, sizeof(ff));
+            return ff;
+        }
+
+        // Returns linear power after converting the median to mean.
+        // Assumes the original data was complex normal, and so the
+        // the mag squared data is Chi-square with 2 degrees of freedom.
+        static inline double medtomean(double median) {
+            return median/::log(2.0);
+        }
+
+    }
+
+    //
+    // Estimates the noise power from the median of the mag squared samples,
+    // which ignores strong signals as long as they occupy less than half
+    // the data.  The default is a two pass histogram on the float bits: the
+    // first pass counts the octaves (exponents), and the second splits the
+    // octave holding the median into 1024 steps, which is better than .01
+    // dB.  With exact set, the mag squared values are copied and the median
+    // is found with introselect.  Inf and NaN count as more power than
+    // anything else, like any other strong signal.
+    //
+    static inline double mednoise(const cfloat* ptr, ssize_t len, bool exact=false) {
+        using namespace internal;
+        check(len > 0, "need at least one sample");
+        const int64 rank = (len - 1)/2;
+
+        if (exact) {
+            vector<float> power(len);
+            for (int64 ii = 0; ii<len; ii++) {
+                const float pp = mag2(ptr[ii]);
+                power[ii] = pp == pp ? pp : HUGE_VALF;
             }
+            introselect(power.data(), len, rank);
+            return medtomean(power[rank]);
+        }
+
+        int64 octaves[256];
+        memset(octaves, 0, sizeof(octaves));
+        for (int64 ii = 0; ii<len; ii++) {
+            octaves[powerbits(ptr[ii]) >> 23]++;
+        }
+        int64 below = 0;
+        uint32_t octave = 0;
+        while (below + octaves[octave] <= rank) {
+            below += octaves[octave++];
         }
 
-        check(false, "shouldn't get here");
-        return -1;
+        int64 steps[1024];
+        memset(steps, 0, sizeof(steps));
+        for (int64 ii = 0; ii<len; ii++) {
+            uint32_t bits = powerbits(ptr[ii]);
+            if ((bits >> 23) == octave) steps[(bits >> 13) & 1023]++;
+        }
+        uint32_t step = 0;
+        while (below + steps[step] <= rank) {
+            below += steps[step++];
+        }
+
+        // the center of the step
+        return medtomean(bitsfloat(octave << 23 | step << 13 | 1 << 12));
+    }
+
+    //
+    // The same estimate over a sliding window of the most recent samples.
+    // Each sample lands in a histogram bin from its float bits (32 steps
+    // per octave, about .1 dB), and the bin of each sample in the window is
+    // kept so it can be taken back out when the sample gets old.  The
+    // median is tracked with a cursor that only moves as far as the counts
+    // on either side change, so an update costs about the same per sample
+    // no matter how long the window is.
+    //
+    struct runmednoise {
+        //~runmednoise() = default;
+        //runmednoise(const runmednoise&) = default;
+        //runmednoise& operator =(const runmednoise&) = default;
+
+        inline runmednoise(int64 window);
+
+        // Adds samples, and drops the oldest ones past the window
+        inline void update(const cfloat* ptr, int64 len);
+
+        // Linear power like mednoise, from the samples in the window
+        inline double estimate() const;
+
+        // The number of samples in the window so far
+        inline int64 size() const;
+
+        private:
+            int64 window;
+            int64 count;           // samples in the window
+            int64 next;            // where the next bin goes in recent
+            int64 bin;             // the bin holding the median
+            int64 below;           // samples in bins before bin
+            vector<int64> histogram;
+            vector<uint16_t> recent;
+
+            inline void settle();
+    };
+
+    runmednoise::runmednoise(int64 window) :
+        window(window), count(0), next(0), bin(0), below(0),
+        histogram(8192, 0), recent(window) {
+        check(window >= 1, "need a positive window (%lld)", window);
+    }
+
+    void runmednoise::update(const cfloat* ptr, int64 len) {
+        using namespace internal;
+        int64* hist = histogram.data();
+        uint16_t* ring = recent.data();
+        for (int64 ii = 0; ii<len; ii++) {
+            if (count == window) {
+                const uint16_t old = ring[next];
+                hist[old]--;
+                below -= old < bin;
+            } else {
+                count++;
+            }
+            const uint16_t index = powerbits(ptr[ii]) >> 18;
+            hist[index]++;
+            below += index < bin;
+            ring[next] = index;
+            if (++next == window) next = 0;
+        }
+        settle();
+    }
+
+    void runmednoise::settle() {
+        if (count == 0) return;
+        const int64 rank = (count - 1)/2;
+        const int64* hist = histogram.data();
+        while (below > rank) {
+            below -= hist[--bin];
+        }
+        while (below + hist[bin] <= rank) {
+            below += hist[bin++];
+        }
+    }
+
+    double runmednoise::estimate() const {
+        using namespace internal;
+        check(count > 0, "need at least one sample");
+        // interpolated by rank within the bin
+        const int64 rank = (count - 1)/2;
+        const double fraction = (rank - below + .5)/histogram[bin];
+        const double lower = bitsfloat(bin << 18);
+        const double upper = bitsfloat((bin + 1) << 18);
+        return medtomean(lower + fraction*(upper - lower));
+    }
+
+    int64 runmednoise::size() const {
+        return count;
     }
 
 }
@@ -0,0 +1,178 @@
+#ifndef XM_PARALLEL_H_
+#define XM_PARALLEL_H_ 1
+
+#include <string.h>
+#include <pthread.h>
+
+#include <new>
+#include <exception>
+
+#include "basics.h"
+#include "list.h"
+
+namespace xm {
+
+    //
+    // A fixed set of worker threads for data parallel loops.  The threads
+    // are started once in the constructor and sleep on a condition variable
+    // between calls to parfor, so it's cheap to use one pool for many small
+    // batches of work.  The thread calling parfor does work too, so a pool
+    // built with threads=1 has no workers and simply runs the loop inline.
+    //
+    // Indices are handed out dynamically, so there's no guarantee which
+    // thread runs which index.  Callers that need deterministic results
+    // should have each index write to its own piece of the output.
+    //
+    struct threadpool {
+        inline ~threadpool();
+        inline threadpool(int64 threads);
+
+        // Calls func(index) for every index in [0, count) and returns
+        // after they've all finished.  If any of the calls throw, the
+        // first error is rethrown here after the rest have completed.
+        template<class callable>
+        void parfor(int64 count, callable& func);
+
+        inline int64 size() const;
+
+        private:
+            threadpool(const threadpool&); // deleted
+            threadpool& operator =(const threadpool&); // deleted
+
+            template<class callable>
+            static void invoke(void* context, int64 index) {
+                (*(callable*)context)(index);
+            }
+
+            static inline void* worker(void* arg);
+            inline void runjob();
+
+            list<pthread_t> workers;
+            pthread_mutex_t mutex;
+            pthread_cond_t wakeup;
+            pthread_cond_t finished;
+
+            // the current job, protected by the mutex
+            void (*function)(void*, int64);
+            void* context;
+            int64 count;
+            int64 generation;
+            int64 running;
+            bool stopping;
+            bool failed;
+            char message[256];
+
+            // handed out with atomic increments
+            int64 next;
+    };
+
+    threadpool::~threadpool() {
+        pthread_mutex_lock(&mutex);
+        stopping = true;
+        pthread_cond_broadcast(&wakeup);
+        pthread_mutex_unlock(&mutex);
+        for (int64 ii = 0; ii<workers.size(); ii++) {
+            pthread_join(workers[ii], 0);
+        }
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&wakeup);
+        pthread_cond_destroy(&finished);
+    }
+
+    threadpool::threadpool(int64 threads) :
+        function(0), context(0), count(0), generation(0),
+        running(0), stopping(false), failed(false), next(0)
+    {
+        check(threads >= 1, "need at least one thread (%lld)", threads);
+        message[0] = 0;
+        pthread_mutex_init(&mutex, 0);
+        pthread_cond_init(&wakeup, 0);
+        pthread_cond_init(&finished, 0);
+        for (int64 ii = 1; ii<threads; ii++) {
+            pthread_t thread;
+            check(
+                pthread_create(&thread, 0, worker, this) == 0,
+                "starting worker thread %lld", ii
+            );
+            workers.append(thread);
+        }
+    }
+
+    template<class callable>
+    void threadpool::parfor(int64 count, callable& func) {
+        if (count <= 0) return;
+
+        pthread_mutex_lock(&mutex);
+        this->function = invoke<callable>;
+        this->context  = &func;
+        this->count    = count;
+        this->next     = 0;
+        this->failed   = false;
+        this->running  = workers.size();
+        generation++;
+        pthread_cond_broadcast(&wakeup);
+        pthread_mutex_unlock(&mutex);
+
+        runjob();
+
+        pthread_mutex_lock(&mutex);
+        while (running > 0) {
+            pthread_cond_wait(&finished, &mutex);
+        }
+        bool failure = failed;
+        pthread_mutex_unlock(&mutex);
+
+        check(!failure, "%s", message);
+    }
+
+    int64 threadpool::size() const {
+        return workers.size() + 1;
+    }
+
+    void* threadpool::worker(void* arg) {
+        threadpool* pool = (threadpool*)arg;
+        int64 seen = 0;
+        for (;;) {
+            pthread_mutex_lock(&pool->mutex);
+            while (pool->generation == seen && !pool->stopping) {
+                pthread_cond_wait(&pool->wakeup, &pool->mutex);
+            }
+            if (pool->stopping) {
+                pthread_mutex_unlock(&pool->mutex);
+                return 0;
+            }
+            seen = pool->generation;
+            pthread_mutex_unlock(&pool->mutex);
+
+            pool->runjob();
+
+            pthread_mutex_lock(&pool->mutex);
+            if (--pool->running == 0) {
+                pthread_cond_signal(&pool->finished);
+            }
+            pthread_mutex_unlock(&pool->mutex);
+        }
+    }
+
+    void threadpool::runjob() {
+        for (;;) {
+            int64 index = __sync_fetch_and_add(&next, 1);
+            if (index >= count) return;
+            try {
+                function(context, index);
+            } catch (const std::exception& err) {
+                pthread_mutex_lock(&mutex);
+                if (!failed) {
+                    failed = true;
+                    strncpy(message, err.what(), sizeof(message) - 1);
+                    message[sizeof(message) - 1] = 0;
+                }
+                pthread_mutex_unlock(&mutex);
+            }
+        }
+    }
+
+}
+
+#endif // XM_PARALLEL_H_
+
@@ -1,6 +1,11 @@
 #ifndef XM_POLYPHASE_H_
 #define XM_POLYPHASE_H_ 1
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "complex.h"
 
 namespace xm {
@@ -12,7 +17,10 @@ namespace xm {
         //polyphase(const polyphase&) = default;
         //polyphase& operator =(const polyphase&) = default;
 
-        inline polyphase(int window, double dwidth, int64 taps);
+        // If cachedir is not empty, the filter bank is loaded from (or saved
+        // to) a file in that directory.  Cached banks are memory-mapped read
+        // only, so concurrent processes using the same filter share pages.
+        inline polyphase(int window, double dwidth, int64 taps, const string& cachedir="");
 
         inline void resample(
             cfloat* dst_ptr, int64 dst_len,
@@ -22,17 +30,76 @@ namespace xm {
         private:
             // XXX: make non-copyable, non-defaultable
             enum { COUNT = 1024 };
+
+            // The bank either lives on the heap or in a mapped cache file.
+            // Copies of the polyphase share the storage.
+            struct storage {
+                ~storage() { if (mapped) munmap(mapped, length); }
+                storage() : mapped(0), length(0) {}
+                vector<float> heap;
+                void* mapped;
+                int64 length;
+            };
+
+            // This is written at the front of each cache file
+            struct cacheheader {
+                char magic[8];
+                int64 window;
+                double dwidth;
+                int64 taps;
+                int64 count;
+                int64 padding[3];
+            };
+
             int64 taps;
-            vector<float> bank;
+            shared<storage*> holder;
+            const float* bank;
 
             inline void makefir(float* ptr, double fract, int window, double dwidth);
+            inline void makebank(float* ptr, int window, double dwidth);
+            inline bool loadcache(const string& path, const cacheheader& want);
+            inline void savecache(const string& path, const cacheheader& want);
             inline cfloat interp(const cfloat* src, double where) const;
     };
 
-    polyphase::polyphase(int window, double dwidth, int64 taps) : taps(taps), bank(taps*COUNT) {
+    polyphase::polyphase(
+        int window, double dwidth, int64 taps, const string& cachedir
+    ) : taps(taps), holder(new storage()), bank(0) {
+        if (cachedir.size() == 0) {
+            holder.value()->heap.resize(taps*COUNT);
+            makebank(holder.value()->heap.data(), window, dwidth);
+            bank = holder.value()->heap.data();
+            return;
+        }
+
+        cacheheader want;
+        memset(&want, 0, sizeof(cacheheader));
+        memcpy(want.magic, "XMPOLYPH", 8);
+        want.window = window;
+        want.dwidth = dwidth;
+        want.taps = taps;
+        want.count = COUNT;
+
+        // the key includes the exact bits of dwidth
+        uint64_t bits;
+        memcpy(&bits, &dwidth, sizeof(double));
+        string path = format(
+            "%s/polyphase-%d-%016llx-%lld-%d.bank", cachedir.data(),
+            window, (unsigned long long)bits, taps, (int)COUNT
+        );
+
+        if (loadcache(path, want)) return;
+
+        holder.value()->heap.resize(taps*COUNT);
+        makebank(holder.value()->heap.data(), window, dwidth);
+        bank = holder.value()->heap.data();
+        savecache(path, want);
+    }
+
+    void polyphase::makebank(float* ptr, int window, double dwidth) {
         for (int64 ii = 0; ii<COUNT; ii++) {
             double fract = ii/(double)COUNT;
-            makefir(bank.data() + ii*taps, fract, window, dwidth);
+            makefir(ptr + ii*taps, fract, window, dwidth);
         }
     }
 
@@ -50,6 +117,64 @@ namespace xm {
         }
     }
 
+    bool polyphase::loadcache(const string& path, const cacheheader& want) {
+        // Any problem with the cache file just means we build it again
+        int fd = ::open(path.data(), O_RDONLY);
+        if (fd < 0) return false;
+
+        const int64 length = sizeof(cacheheader) + taps*COUNT*sizeof(float);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size != length) {
+            ::close(fd);
+            return false;
+        }
+
+        void* mapped = ::mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+
+        if (memcmp(mapped, &want, sizeof(cacheheader)) != 0) {
+            munmap(mapped, length);
+            return false;
+        }
+
+        holder.value()->mapped = mapped;
+        holder.value()->length = length;
+        bank = (const float*)((const char*)mapped + sizeof(cacheheader));
+        return true;
+    }
+
+    void polyphase::savecache(const string& path, const cacheheader& want) {
+        // Concurrent processes might be building the same entry, so each
+        // writes to its own temporary file and atomically renames it into
+        // place.  Readers only ever see complete files.  Failures here are
+        // not fatal since we already have the bank in memory.
+        size_t cut = path.size();
+        while (cut > 0 && path.data()[cut - 1] != '/') --cut;
+        if (cut > 1) {
+            string dir = substr(path, 0, cut - 1);
+            ::mkdir(dir.data(), 0777);
+        }
+
+        struct timespec ts = { 0, 0 };
+        clock_gettime(CLOCK_REALTIME, &ts);
+        string temp = format(
+            "%s.%d.%ld.tmp", path.data(), (int)getpid(), (long)ts.tv_nsec
+        );
+        int fd = ::open(temp.data(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd < 0) return;
+
+        const int64 bytes = taps*COUNT*sizeof(float);
+        bool good = (
+            ::write(fd, &want, sizeof(cacheheader)) == sizeof(cacheheader) &&
+            ::write(fd, bank, bytes) == bytes
+        );
+        good = (::close(fd) == 0) && good;
+        if (!good || ::rename(temp.data(), path.data()) != 0) {
+            ::unlink(temp.data());
+        }
+    }
+
     cfloat polyphase::interp(const cfloat* src, double where) const {
         double re = 0;
         double im = 0;
@@ -57,7 +182,7 @@ namespace xm {
         int64 index = fixed/COUNT;
         int64 which = fixed%COUNT;
         const cfloat* ptr = src + index + 1 - taps/2;
-        const float* filt = bank.data() + taps*which;
+        const float* filt = bank + taps*which;
         for (int64 ii = 0; ii<taps; ii++) {
             re += ptr[ii].re*filt[ii];
             im += ptr[ii].im*filt[ii];
@@ -65,7 +65,7 @@ namespace xm {
 
     template<class type>
     type queue<type>::pull() {
-        type item;
+        type item = type();
         pthread_mutex_lock(&mutex);
 
         while (data.size() == 0) {
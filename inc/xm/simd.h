@@ -0,0 +1,75 @@
+#ifndef XM_SIMD_H_
+#define XM_SIMD_H_ 1
+
+#include <string.h>
+#include <stdint.h>
+
+namespace xm {
+
+    //{{{ types
+
+    // These use the GCC vector extensions, so the compiler picks the
+    // instructions.  Wider types than the target supports still work,
+    // they just get split into multiple registers.
+#define define_simdtype(NAME, BASE, COUNT) \
+    typedef BASE NAME __attribute__(       \
+        (vector_size (COUNT*sizeof(BASE))) \
+    )
+
+    // 128 bit SIMD (SSE, NEON)
+    define_simdtype(i8x16,    int8_t, 16);
+    define_simdtype(i16x8,   int16_t,  8);
+    define_simdtype(i32x4,   int32_t,  4);
+    define_simdtype(i64x2,   int64_t,  2);
+    define_simdtype(u8x16,   uint8_t, 16);
+    define_simdtype(u16x8,  uint16_t,  8);
+    define_simdtype(u32x4,  uint32_t,  4);
+    define_simdtype(u64x2,  uint64_t,  2);
+    define_simdtype(f32x4,     float,  4);
+    define_simdtype(f64x2,    double,  2);
+
+    // 256 bit SIMD (AVX)
+    define_simdtype( i32x8,  int32_t,  8);
+    define_simdtype( i64x4,  int64_t,  4);
+    define_simdtype( f32x8,    float,  8);
+    define_simdtype( f64x4,   double,  4);
+
+#undef define_simdtype
+
+    //}}}
+    //{{{ loads and stores
+
+    // Unaligned loads and stores.  The memcpy compiles to a single
+    // instruction, and it avoids the aliasing and alignment rules.
+    template<class vtype, class stype>
+    static inline vtype simdload(const stype* ptr) {
+        vtype result;
+        memcpy(&result, ptr, sizeof(vtype));
+        return result;
+    }
+
+    template<class vtype, class stype>
+    static inline void simdstore(stype* ptr, const vtype& val) {
+        memcpy(ptr, &val, sizeof(vtype));
+    }
+
+    //}}}
+    //{{{ lane operations
+
+    // Lane by lane min and max, a single instruction on most targets
+    template<class vtype>
+    static inline vtype simdmin(const vtype& aa, const vtype& bb) {
+        return aa < bb ? aa : bb;
+    }
+
+    template<class vtype>
+    static inline vtype simdmax(const vtype& aa, const vtype& bb) {
+        return aa > bb ? aa : bb;
+    }
+
+    //}}}
+
+}
+
+#endif // XM_SIMD_H_
+
@@ -152,6 +152,52 @@ namespace xm {
         introsort(data, len, compare_lt<type>);
     }
 
+    // Partially sorts so data[pos] is the element that would be there if
+    // the data were sorted, with nothing after it less and nothing before
+    // it greater.  This is quickselect with the same dual pivots as
+    // introsort, and it falls back to heapsort on whatever is left if the
+    // partitions keep coming out lopsided.
+    template<class type, class compare>
+    void introselect(type* data, int64 len, int64 pos, compare& lessthan) {
+        using namespace internal;
+        if (pos < 0 || pos >= len) return;
+        int64 depth = 8*sizeof(long long) - __builtin_clzll(len);
+        type* lo = data;
+        type* hi = data + len - 1;
+        type* target = data + pos;
+        while (hi - lo > 8) {
+            if (depth-- < 0) {
+                heapsort(lo, hi - lo + 1, lessthan);
+                return;
+            }
+
+            //     +---+---+---+---+---+---+---+---+---+---+---+
+            //     | < | < | < | L | ~ | ~ | ~ | H | > | > | > |
+            //     +---+---+---+---+---+---+---+---+---+---+---+
+            //     ^lo         ^lt                 ^gt     ^hi
+            type *lt, *gt;
+            dualpivot(lo, hi, lt, gt, lessthan);
+            if (target < lt) {
+                hi = lt - 1;
+            } else if (target >= gt) {
+                lo = gt;
+            } else if (target == lt || target == gt - 1) {
+                return;
+            } else {
+                // the centers are all equal when the pivots are
+                if (!lessthan(*lt, gt[-1])) return;
+                lo = lt + 1;
+                hi = gt - 2;
+            }
+        }
+        recursort(lo, hi, 0, lessthan);
+    }
+
+    template<class type>
+    void introselect(type* data, int64 len, int64 pos) {
+        introselect(data, len, pos, compare_lt<type>);
+    }
+
     /* XXX: do these for vector<> and list<> ?
     template<class type, int64 size, class compare>
     void introsort(vector<type, size>& vv, compare& lessthan) {
@@ -0,0 +1,126 @@
+#ifndef XM_TFD_H_
+#define XM_TFD_H_ 1
+
+#include <math.h>
+
+#include "basics.h"
+#include "complex.h"
+#include "simd.h"
+#include "vector.h"
+#include "firwin.h"
+#include "blocktuner.h"
+
+namespace xm {
+
+    //
+    // Tune, filter, and decimate in one step.  This uses the trick (from
+    // Mark Borgerding) of moving the tuning to the other side of the filter.
+    // Tuning the input by w**n and filtering with h is the same as filtering
+    // the untuned input with the complex bandpass taps h[k]*w**-k and then
+    // tuning the output.  Since we only compute the outputs we keep, both
+    // the filter and the tuner run at the decimated rate, and the input is
+    // only read once, straight from the grab buffer.
+    //
+    // Output m is centered on input sample m*decim.  The taps are always an
+    // odd count, so that's an exact sample and there's no extra delay.
+    //
+    struct tfd {
+        //~tfd() = default;
+        //tfd() = default;
+        //tfd(const tfd&) = default;
+        //tfd& operator =(const tfd&) = default;
+
+        // dfreq is applied to the input like blocktuner (cycles per sample).
+        // The lowpass keeps dwidth (fraction of the input rate) with the
+        // window and length used for resampling in polyphase.
+        inline tfd(double dfreq, int64 decim, int window, double dwidth, int64 taps);
+
+        // The number of inputs before (and after) an output's center
+        inline int64 margin() const;
+
+        // Input needed for len outputs: src[0] is input sample off*decim - margin()
+        inline int64 needed(int64 len) const;
+
+        // Computes outputs [off, off + len).
+        inline void apply(cfloat* dst, int64 off, int64 len, const cfloat* src);
+
+        private:
+            int64 decim;
+            int64 taps;
+            // reversed bandpass taps, pre-split for SIMD the same way as
+            // in blocktuner, and padded with a zero to an even count
+            vector<float> bandre;
+            vector<float> bandim;
+            blocktuner tuner;
+
+            inline cfloat dotprod(const float* src) const;
+    };
+
+    tfd::tfd(
+        double dfreq, int64 decim, int window, double dwidth, int64 taps
+    ) : decim(decim), taps(taps | 1), tuner(dfreq*decim) {
+        check(decim >= 1, "need positive decimation (%lld)", decim);
+        check(taps >= 1, "need positive taps (%lld)", taps);
+
+        const int64 center = this->taps/2;
+        const int64 padded = this->taps + 1;
+        vector<double> lowpass(this->taps);
+        double sum = 0.0;
+        for (int64 kk = 0; kk<this->taps; kk++) {
+            double xx = kk - center;
+            lowpass[kk] = firwin(window, xx, this->taps)*sinc(xx*dwidth);
+            sum += lowpass[kk];
+        }
+
+        // tap jj multiplies input sample m*decim - center + jj
+        bandre.resize(2*padded, 0.0f);
+        bandim.resize(2*padded, 0.0f);
+        dfreq = fmod(dfreq, 1.0);
+        for (int64 jj = 0; jj<this->taps; jj++) {
+            double angle = 2*M_PI*dfreq*(jj - center);
+            double re = lowpass[jj]/sum*cos(angle);
+            double im = lowpass[jj]/sum*sin(angle);
+            bandre[2*jj + 0] = re;
+            bandre[2*jj + 1] = re;
+            bandim[2*jj + 0] = -im;
+            bandim[2*jj + 1] = im;
+        }
+    }
+
+    int64 tfd::margin() const {
+        return taps/2;
+    }
+
+    int64 tfd::needed(int64 len) const {
+        if (len <= 0) return 0;
+        return (len - 1)*decim + taps + 1;
+    }
+
+    cfloat tfd::dotprod(const float* src) const {
+        const i32x4 flip = { 1, 0, 3, 2 };
+        const float* tre = bandre.data();
+        const float* tim = bandim.data();
+        f32x4 acc0 = { 0, 0, 0, 0 };
+        f32x4 acc1 = { 0, 0, 0, 0 };
+        // the padding tap is zero, so reading one sample past the
+        // last tap is harmless, and needed() includes that sample
+        for (int64 jj = 0; jj<taps; jj += 2) {
+            f32x4 xx = simdload<f32x4>(src + 2*jj);
+            acc0 += xx*simdload<f32x4>(tre + 2*jj);
+            acc1 += __builtin_shuffle(xx, flip)*simdload<f32x4>(tim + 2*jj);
+        }
+        f32x4 acc = acc0 + acc1;
+        return cfloat(acc[0] + acc[2], acc[1] + acc[3]);
+    }
+
+    void tfd::apply(cfloat* dst, int64 off, int64 len, const cfloat* src) {
+        for (int64 ii = 0; ii<len; ii++) {
+            dst[ii] = dotprod((const float*)(src + ii*decim));
+        }
+        tuner.apply(dst, off, len);
+    }
+
+}
+
+#endif // XM_TFD_H_
+
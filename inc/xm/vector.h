@@ -1,8 +1,11 @@
 #ifndef XM_VECTOR_H_
 #define XM_VECTOR_H_ 1
 
+#include <new>
+
 #include "basics.h"
 #include "promote.h"
+#include "complex.h"
 
 namespace xm {
 
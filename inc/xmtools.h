@@ -37,10 +37,12 @@
 #include "xm/shared.h"
 #include "xm/tuple.h"
 #include "xm/queue.h"
+#include "xm/parallel.h"
 #include "xm/compare.h"
 #include "xm/sort.h"
 #include "xm/string.h"
 #include "xm/complex.h"
+#include "xm/simd.h"
 #include "xm/vector.h"
 #include "xm/matrix.h"
 #include "xm/cholesky.h"
@@ -52,12 +54,23 @@
 #include "xm/gpsgold.h"
 #include "xm/bessel.h"
 #include "xm/firwin.h"
+#include "xm/firparks.h"
 #include "xm/rician.h"
 #include "xm/mednoise.h"
 #include "xm/fftshift.h"
+#include "xm/kissfft.h"
 #include "xm/blocktuner.h"
+#include "xm/chirptuner.h"
 #include "xm/singleton.h"
 #include "xm/polyphase.h"
+#include "xm/tfd.h"
+#include "xm/channelizer.h"
+#include "xm/cic.h"
+#include "xm/halfband.h"
+#include "xm/baseband.h"
+#include "xm/fastconv.h"
+#include "xm/caf.h"
+#include "xm/demod.h"
 #include "xm/cartesian.h"
 #include "xm/geodetic.h"
 #include "xm/timecode.h"
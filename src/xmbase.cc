@@ -0,0 +1,95 @@
+#include "xmtools.h"
+using namespace xm;
+
+template<class type>
+int convert(
+    bluereader& input, bluewriter& output, int window, double percent,
+    int64 offset, int64 length
+) {
+    baseband engine(window, percent);
+
+    // output m is centered on input sample offset + 2*m
+    const int64 first = offset/2;
+    const int64 block = 65536;
+    vector<type> grab(engine.needed(block));
+    vector<cfloat> data(block);
+
+    for (int64 done = 0; done < length; done += block) {
+        int64 amount = min(block, length - done);
+        int64 needed = engine.needed(amount);
+        int64 start = 2*(first + done) - engine.margin();
+        input.grab(start*sizeof(type), grab.data(), needed*sizeof(type));
+        if (input.is_swapped()) {
+            for (int64 ii = 0; ii<needed; ii++) {
+                switch (sizeof(type)) {
+                    case 2: internal::byteswap2(grab.data() + ii); break;
+                    case 4: internal::byteswap4(grab.data() + ii); break;
+                    case 8: internal::byteswap8(grab.data() + ii); break;
+                }
+            }
+        }
+
+        engine.apply(data.data(), first + done, amount, grab.data());
+        output.write(data.data(), amount*sizeof(cfloat));
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    cmdline args(
+        argc, argv, "convert real-valued data to complex\n"
+        "tunes the data down by fs/4, filters using a halfband filter,\n"
+        "and decimates by two.  Similar to a Hilbert transform."
+    );
+    const timecode deftime = { 0, nan("sentinel") };
+    timecode tstart  = args.gettimecode("tstart", deftime, "starting time (default beginning)");
+    double tspan     = args.getdouble("tspan", -1, "time span after start (default all)");
+    double percent   = args.getdouble("percent", 80, "percentage of output bandwidth to preserve");
+    int64 window     = args.getint64("firwin", 2, "FIR window for the halfband");
+    bool copykwds    = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath    = args.getinput("input.tmp", "input real-valued data");
+    string outpath   = args.getoutput("output.tmp", "output complex float");
+    args.done();
+
+    check(percent > 0 && percent < 100, "percent must be in (0, 100)");
+
+    bluereader input(inpath);
+    check(input->format.data()[0] == 'S', "requires real-valued input");
+    check(input->type/1000 == 1, "requires Type 1000 input");
+
+    // start on an even sample so the tune lines up with the file
+    const timecode tbegin = input->time + input->xstart;
+    if (isnan(tstart.fract)) tstart = tbegin;
+    int64 offset = (int64)floor((tstart - tbegin)/input->xdelta);
+    offset -= offset & 1;
+    // the default is whatever remains after the start
+    int64 inputs = input->xcount - offset;
+    if (tspan >= 0) inputs = (int64)ceil(tspan/input->xdelta);
+    check(inputs >= 0, "tstart is past the end of the file");
+    const int64 length = (inputs + 1)/2;
+
+    bluewriter output(outpath);
+    output->time   = input->time;
+    output->xstart = input->xstart + offset*input->xdelta;
+    output->xdelta = input->xdelta*2;
+    output->xcount = length;
+    output->xunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    switch (input->format.data()[1]) {
+        case 'B': return convert<int8_t>  (input, output, window, percent, offset, length);
+        case 'I': return convert<int16_t> (input, output, window, percent, offset, length);
+        case 'L': return convert<int32_t> (input, output, window, percent, offset, length);
+        case 'X': return convert<int64_t> (input, output, window, percent, offset, length);
+        case 'F': return convert<float>   (input, output, window, percent, offset, length);
+        case 'D': return convert<double>  (input, output, window, percent, offset, length);
+        default: check(false, "unsupported input file format");
+    }
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "xmtools.h"
+using namespace xm;
+
+// Each index is one slice of the rows in a block, and each slice has its own
+// channelizer, since the FFT in there keeps scratch space.
+struct slicer {
+    channelizer** engines;
+    int64 block_offset, block_length;
+    int64 decim, channels, slice;
+    const cfloat* grab;
+    cfloat* data;
+
+    void operator ()(int64 index) {
+        int64 lo = index*slice;
+        int64 hi = min(lo + slice, block_length);
+        if (lo >= hi) return;
+        engines[index]->apply(
+            data + lo*channels, block_offset + lo, hi - lo, grab + lo*decim
+        );
+    }
+};
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "bank of tuners\n"
+        "splits the input into evenly spaced channels with a polyphase filter bank"
+    );
+    int64 channels  = args.getint64("channels", "number of channels");
+    bool oversample = args.getswitch("oversample", "decimate by channels/2 instead of channels");
+    double percent  = args.getdouble("percent", 100, "percentage of the channel spacing to preserve");
+    int64 window    = args.getint64("firwin", 2, "FIR window for the prototype lowpass");
+    int64 threads   = args.getint64("threads", 1, "number of threads for channelizing");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(channels >= 1, "need positive channels");
+    check(!oversample || channels%2 == 0, "need an even number of channels to oversample");
+    check(percent > 0 && percent <= 200, "percent must be in (0, 200]");
+    check(threads >= 1, "need at least one thread");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+
+    const int64 decim = oversample ? channels/2 : channels;
+    double dwidth = percent * .01 / channels;
+    int64 branch = (int64)ceil(8 * apodize(window) / (dwidth*channels));
+    channelizer engine(channels, decim, window, dwidth, branch);
+
+    const int64 rows = (input->xcount + decim - 1)/decim;
+
+    bluewriter output(outpath);
+    output->type   = 2000;
+    output->format = "CF";
+    output->time   = input->time;
+    output->xstart = -(channels/2)/(input->xdelta*channels);
+    output->xdelta = 1/(input->xdelta*channels);
+    output->xcount = channels;
+    output->xunits = blueunits::freq;
+    output->ystart = input->xstart;
+    output->ydelta = input->xdelta*decim;
+    output->ycount = rows;
+    output->yunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    threadpool pool(threads);
+    list<channelizer*> engines;
+    for (int64 ii = 0; ii<threads; ii++) {
+        engines.append(new channelizer(engine));
+    }
+
+    // Size the blocks so the input and output for each stays around a few
+    // MB, but give every thread at least one row.
+    const int64 block = max(threads, 262144/max(decim, channels));
+    const int64 slice = (block + threads - 1)/threads;
+    vector<cfloat> data(block*channels);
+    vector<cfloat> grab(engine.needed(block));
+
+    slicer work;
+    work.engines  = engines.data();
+    work.decim    = decim;
+    work.channels = channels;
+    work.slice    = slice;
+    work.grab     = grab.data();
+    work.data     = data.data();
+
+    int64 offset = 0;
+    while (offset < rows) {
+        int64 amount = min(block, rows - offset);
+
+        input.grabcf(offset*decim - engine.margin(), grab.data(), engine.needed(amount));
+        work.block_offset = offset;
+        work.block_length = amount;
+        pool.parfor(threads, work);
+
+        // center the channels so the columns go from -fs/2 up
+        hshift(data.data(), amount, channels, (channels + 1)/2);
+        output.write(data.data(), amount*channels*sizeof(cfloat));
+
+        offset += amount;
+    }
+
+    for (int64 ii = 0; ii<threads; ii++) {
+        delete engines[ii];
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,88 @@
+#include "xmtools.h"
+using namespace xm;
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "complex ambiguity function\n"
+        "makes a Type 2000 surface with a row per Doppler and a column per delay"
+    );
+    double fcenter  = args.getdouble("fcenter", 0.0, "center of the Doppler rows (Hz)");
+    double fspan    = args.getdouble("fspan", 0.0, "span of the Doppler rows (Hz), 0 for just the center");
+    int64 oversample = args.getint64("oversample", 1, "Doppler rows per FFT bin");
+    double dcenter  = args.getdouble("dcenter", 0.0, "center of the delay columns (seconds)");
+    double dspan    = args.getdouble("dspan", -1, "span of the delay columns (seconds), default is all delays");
+    int64 threads   = args.getint64("threads", 1, "number of threads for the FFTs");
+    string refpath  = args.getinput("reference.tmp", "reference blue file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(fspan >= 0, "need non-negative Doppler span");
+    check(oversample >= 1, "need positive oversample");
+    check(threads >= 1, "need at least one thread");
+
+    bluereader reference(refpath);
+    bluereader input(inpath);
+    check(reference->type/1000 == 1, "reference must be Type 1000 file");
+    check(input->type/1000 == 1, "input must be Type 1000 file");
+    check(
+        fabs(reference->xdelta/input->xdelta - 1) < 1e-9,
+        "reference and input need the same sample rate"
+    );
+    const int64 n1 = reference->xcount;
+    const int64 n2 = input->xcount;
+    check(n1 >= 1 && n2 >= 1, "need non-empty files");
+    const double xdelta = input->xdelta;
+
+    vector<cfloat> s1(n1);
+    vector<cfloat> s2(n2);
+    reference.grabcf(0, s1.data(), n1);
+    input.grabcf(0, s2.data(), n2);
+
+    threadpool pool(threads);
+    caf engine(s1.data(), n1, s2.data(), n2, oversample, pool);
+    s1.clear();
+    s2.clear();
+
+    // delay of lag zero, from the start times of the two files
+    const double offset = (input->time - reference->time) + input->xstart - reference->xstart;
+    int64 lag = 1 - n1;
+    int64 cols = n1 + n2 - 1;
+    if (dspan >= 0) {
+        const int64 middle = (int64)round((dcenter - offset)/xdelta);
+        const int64 half = (int64)floor(dspan/2/xdelta);
+        lag = max(lag, middle - half);
+        cols = min(n2, middle + half + 1) - lag;
+        check(cols >= 1, "no overlap for delays around %lf", dcenter);
+    }
+
+    const double fstep = 1/(xdelta*engine.fftsize()*oversample);
+    const int64 fhalf = (int64)floor(fspan/2/fstep);
+    const int64 doppler = (int64)round(fcenter/fstep) - fhalf;
+    const int64 rows = 2*fhalf + 1;
+
+    bluewriter output(outpath);
+    output->type   = 2000;
+    output->format = "SF";
+    output->time   = input->time;
+    output->xstart = offset + lag*xdelta;
+    output->xdelta = xdelta;
+    output->xcount = cols;
+    output->xunits = blueunits::delay;
+    output->ystart = doppler*fstep;
+    output->ydelta = fstep;
+    output->ycount = rows;
+    output->yunits = blueunits::freq;
+
+    // a few MB of rows at a time, with at least one for every thread
+    const int64 block = max(threads, 1048576/cols);
+    vector<float> buffer(block*cols);
+    for (int64 row = 0; row<rows; row += block) {
+        const int64 amount = min(block, rows - row);
+        engine.surface(buffer.data(), doppler + row, amount, lag, cols, pool);
+        output.write(buffer.data(), amount*cols*sizeof(float));
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "xmtools.h"
+using namespace xm;
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "take channels from xmbot output\n"
+        "extracts adjacent columns of a Type 2000 file, optionally retuning them"
+    );
+    double freq     = args.getdouble("freq", "center frequency of the first channel (Hz)");
+    int64 count     = args.getint64("count", 1, "number of adjacent channels");
+    bool retune     = args.getswitch("retune", "tune the remainder of freq to baseband");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(count >= 1, "need at least one channel");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 2, "must be Type 2000 file");
+
+    // pick the nearest column, and what's left over is a fine tune
+    const int64 column = llrint((freq - input->xstart)/input->xdelta);
+    check(
+        column >= 0 && column + count <= input->xcount,
+        "channels [%lld, %lld) are outside the file's %lld columns",
+        column, column + count, input->xcount
+    );
+    const double leftover = freq - (input->xstart + column*input->xdelta);
+    blocktuner tuner(-leftover*input->ydelta);
+
+    const int64 rows = input->ycount;
+
+    bluewriter output(outpath);
+    output->time = input->time;
+    if (count == 1) {
+        output->xstart = input->ystart;
+        output->xdelta = input->ydelta;
+        output->xcount = rows;
+        output->xunits = input->yunits;
+    } else {
+        output->type   = 2000;
+        output->format = "CF";
+        // after retuning, DC in each column is the offset frequency
+        output->xstart = freq - (retune ? 0 : leftover);
+        output->xdelta = input->xdelta;
+        output->xcount = count;
+        output->xunits = input->xunits;
+        output->ystart = input->ystart;
+        output->ydelta = input->ydelta;
+        output->ycount = rows;
+        output->yunits = input->yunits;
+    }
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    const int64 block = max(1024, 1048576/count);
+    vector<cfloat> data(block*count);
+    vector<cfloat> series(block);
+
+    int64 offset = 0;
+    while (offset < rows) {
+        int64 amount = min(block, rows - offset);
+
+        input.grabcols(offset, amount, column, count, data.data());
+
+        if (retune && leftover != 0) {
+            for (int64 jj = 0; jj<count; jj++) {
+                for (int64 ii = 0; ii<amount; ii++) {
+                    series[ii] = data[ii*count + jj];
+                }
+                tuner.apply(series.data(), offset, amount);
+                for (int64 ii = 0; ii<amount; ii++) {
+                    data[ii*count + jj] = series[ii];
+                }
+            }
+        }
+        output.write(data.data(), amount*count*sizeof(cfloat));
+
+        offset += amount;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,145 @@
+#include "xmtools.h"
+using namespace xm;
+
+// Runs the CIC on raw samples straight from the file
+template<class type>
+static int64 integrate(cic& engine, int64* dst, char* raw, int64 frames, int64 lanes, bool swapped) {
+    type* ptr = (type*)raw;
+    if (swapped && sizeof(type) > 1) {
+        for (int64 ii = 0; ii<frames*lanes; ii++) {
+            if (sizeof(type) == 2) internal::byteswap2(ptr + ii);
+            if (sizeof(type) == 4) internal::byteswap4(ptr + ii);
+        }
+    }
+    return engine.apply(dst, ptr, frames);
+}
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "cascade integrate comb\n"
+        "decimates integer samples by large ratios, then compensates for the droop"
+    );
+    int64 ratio     = args.getint64("ratio", "decimation ratio");
+    int64 stages    = args.getint64("stages", 4, "number of integrator and comb stages");
+    int64 taps      = args.getint64("taps", 31, "compensation filter taps (1 for none)");
+    double percent  = args.getdouble("percent", 80, "percentage of output bandwidth to compensate");
+    int64 window    = args.getint64("firwin", 2, "FIR window for the compensation filter");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(ratio >= 1, "need positive ratio");
+    check(taps >= 1, "need positive taps");
+    check(percent > 0 && percent <= 100, "percent must be in (0, 100]");
+    taps |= 1;
+
+    bluereader input(inpath);
+    const int64 kind = input->type/1000;
+    check(kind == 1 || kind == 2, "must be Type 1000 or 2000 file");
+
+    const string format = input->format;
+    check(
+        format == "CB" || format == "CI" || format == "CL" ||
+        format == "SB" || format == "SI" || format == "SL",
+        "need integer samples, not '%s'", format.data()
+    );
+    const bool iscomplex = format.data()[0] == 'C';
+    const int64 bits = format.data()[1] == 'B' ? 8 : format.data()[1] == 'I' ? 16 : 32;
+    const int64 channels = kind == 2 ? input->xcount : 1;
+    const int64 frames = kind == 2 ? input->ycount : input->xcount;
+    const int64 lanes = channels*(iscomplex ? 2 : 1);
+    const int64 framebytes = lanes*bits/8;
+
+    cic engine(stages, ratio, lanes, bits);
+    vector<double> comp = cicfir(stages, ratio, window, percent*.005, taps);
+    const int64 center = taps/2;
+    const int64 samples = frames/ratio;
+
+    // output m is centered on this input sample
+    const double lag = (ratio - 1) - stages*(ratio - 1)*.5;
+
+    bluewriter output(outpath);
+    output->time   = input->time;
+    output->type   = kind*1000;
+    output->format = iscomplex ? "CF" : "SF";
+    if (kind == 1) {
+        output->xstart = input->xstart + lag*input->xdelta;
+        output->xdelta = input->xdelta*ratio;
+        output->xcount = samples;
+        output->xunits = input->xunits;
+    } else {
+        output->xstart = input->xstart;
+        output->xdelta = input->xdelta;
+        output->xcount = input->xcount;
+        output->xunits = input->xunits;
+        output->ystart = input->ystart + lag*input->ydelta;
+        output->ydelta = input->ydelta*ratio;
+        output->ycount = samples;
+        output->yunits = input->yunits;
+    }
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    // Blocks are a few MB of input, and the held frames for the
+    // compensation filter start with the zeros before the first output
+    const int64 block = max(1, 4194304/framebytes);
+    const int64 most = block/ratio + 1;
+    vector<char> raw(block*framebytes);
+    vector<int64> decimated(most*lanes);
+    vector<float> held((taps + most)*lanes, 0.0f);
+    vector<float> filtered(most*lanes);
+    const double scale = 1/engine.gain();
+    int64 have = center;
+
+    int64 offset = 0;
+    int64 written = 0;
+    while (written < samples) {
+        int64 amount = min(block, frames - offset);
+        int64 count = 0;
+        if (amount > 0) {
+            input.grab(offset*framebytes, raw.data(), amount*framebytes);
+            switch (bits) {
+                case  8: count = integrate<int8_t>(engine, decimated.data(), raw.data(), amount, lanes, input.is_swapped()); break;
+                case 16: count = integrate<int16_t>(engine, decimated.data(), raw.data(), amount, lanes, input.is_swapped()); break;
+                case 32: count = integrate<int32_t>(engine, decimated.data(), raw.data(), amount, lanes, input.is_swapped()); break;
+            }
+            offset += amount;
+            for (int64 ii = 0; ii<count*lanes; ii++) {
+                held[have*lanes + ii] = decimated[ii]*scale;
+            }
+            have += count;
+        } else {
+            // the zeros after the last output
+            for (int64 ii = 0; ii<center*lanes; ii++) {
+                held[have*lanes + ii] = 0.0f;
+            }
+            have += center;
+        }
+
+        int64 ready = min(have - (taps - 1), samples - written);
+        if (ready <= 0) continue;
+        for (int64 mm = 0; mm<ready; mm++) {
+            for (int64 ll = 0; ll<lanes; ll++) {
+                double acc = 0;
+                for (int64 jj = 0; jj<taps; jj++) {
+                    acc += comp[jj]*held[(mm + jj)*lanes + ll];
+                }
+                filtered[mm*lanes + ll] = acc;
+            }
+        }
+        output.write(filtered.data(), ready*lanes*sizeof(float));
+        written += ready;
+
+        // keep what the next outputs still need
+        have -= ready;
+        memmove(held.data(), held.data() + ready*lanes, have*lanes*sizeof(float));
+    }
+
+    return 0;
+}
+
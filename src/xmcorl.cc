@@ -0,0 +1,226 @@
+#include "xmtools.h"
+using namespace xm;
+
+//
+// Overlap-save correlation: each block transforms size samples of data,
+// multiplies by the conjugate transform of the reference, and transforms
+// back, which leaves size - refs + 1 valid lags.  Each index of the
+// parfor is one block with its own scratch space.
+//
+struct correlator {
+    const kissfft<float>* forward;
+    const kissfft<float>* inverse;
+    const cfloat* filter;   // conj(FFT(reference))/size
+    const cfloat* data;
+    float* result;
+    int64 size, refs, step, lags, each;
+    double refnorm;
+    bool magnitude;
+    cfloat* scratch;
+
+    void operator ()(int64 index) {
+        const int64 lo = index*step;
+        const int64 count = min(step, lags - lo);
+        if (count <= 0) return;
+        cfloat* freq = scratch + index*each;
+        cfloat* work = freq + size;
+        const cfloat* src = data + lo;
+
+        forward->exec(freq, src, work);
+        for (int64 kk = 0; kk<size; kk++) {
+            freq[kk] *= filter[kk];
+        }
+        inverse->exec(freq, freq, work);
+
+        float* dst = result + lo;
+        if (magnitude) {
+            for (int64 ll = 0; ll<count; ll++) {
+                dst[ll] = mag(freq[ll]);
+            }
+            return;
+        }
+
+        // normalized by the energy of the data under the reference
+        double energy = 0;
+        for (int64 nn = 0; nn<refs; nn++) {
+            energy += mag2(src[nn]);
+        }
+        for (int64 ll = 0; ll<count; ll++) {
+            double denom = refnorm*sqrt(max(energy, 0.0));
+            dst[ll] = denom > 0 ? mag(freq[ll])/denom : 0;
+            // the last lag of a full block would slide past the data
+            if (ll + 1 < count) energy += mag2(src[ll + refs]) - mag2(src[ll]);
+        }
+    }
+};
+
+// The largest local maxima, at least apart lags from each other
+struct peaks {
+    int64 most, apart;
+    list<int64> where;
+    list<float> value;
+
+    void consider(int64 lag, float val) {
+        if (most == 0) return;
+        // a neighbor that's already kept wins or loses outright
+        for (int64 ii = 0; ii<where.size(); ii++) {
+            if (llabs(where[ii] - lag) < apart) {
+                if (val <= value[ii]) return;
+                where[ii] = lag;
+                value[ii] = val;
+                return;
+            }
+        }
+        if (where.size() < most) {
+            where.append(lag);
+            value.append(val);
+            return;
+        }
+        int64 low = 0;
+        for (int64 ii = 1; ii<where.size(); ii++) {
+            if (value[ii] < value[low]) low = ii;
+        }
+        if (val > value[low]) {
+            where[low] = lag;
+            value[low] = val;
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "linear correlation\n"
+        "slides a reference along the data with FFTs and reports the peaks"
+    );
+    int64 count     = args.getint64("peaks", 5, "number of peaks to report");
+    int64 threads   = args.getint64("threads", 1, "number of threads for the FFTs");
+    bool magnitude  = args.getswitch("magnitude", "write |correlation| instead of the coefficient");
+    string refpath  = args.getinput("reference.tmp", "reference blue file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(count >= 0, "need non-negative peaks");
+    check(threads >= 1, "need at least one thread");
+
+    bluereader reference(refpath);
+    bluereader input(inpath);
+    check(reference->type/1000 == 1, "reference must be Type 1000 file");
+    check(input->type/1000 == 1, "input must be Type 1000 file");
+    check(
+        fabs(reference->xdelta/input->xdelta - 1) < 1e-9,
+        "reference and input need the same sample rate"
+    );
+    const int64 refs = reference->xcount;
+    check(refs >= 1, "need a non-empty reference");
+    check(input->xcount >= refs, "input is shorter than the reference");
+    const int64 lags = input->xcount - refs + 1;
+
+    // pick the FFT size with the least work per lag
+    int64 size = 1;
+    while (size < 2*refs) size *= 2;
+    double best = 1e300;
+    int64 choice = size;
+    for (int64 trial = size; trial <= max(65536, 2*size); trial *= 2) {
+        double cost = trial*(log2((double)trial) + 2)/(trial - refs + 1);
+        if (cost < best) {
+            best = cost;
+            choice = trial;
+        }
+    }
+    size = choice;
+    const int64 step = size - refs + 1;
+
+    kissfft<float> forward(size);
+    kissfft<float> inverse(size, true);
+    vector<cfloat> filter(size, cfloat(0, 0));
+    reference.grabcf(0, filter.data(), refs);
+    double refnorm = 0;
+    for (int64 nn = 0; nn<refs; nn++) {
+        refnorm += mag2(filter[nn]);
+    }
+    refnorm = sqrt(refnorm);
+    forward.exec(filter.data(), filter.data());
+    for (int64 kk = 0; kk<size; kk++) {
+        filter[kk] = conj(filter[kk])/(float)size;
+    }
+
+    bluewriter output(outpath);
+    output->format = "SF";
+    output->time   = input->time;
+    output->xstart = (input->time - reference->time) + input->xstart - reference->xstart;
+    output->xdelta = input->xdelta;
+    output->xcount = lags;
+    output->xunits = blueunits::delay;
+
+    // Each read covers a few blocks per thread
+    threadpool pool(threads);
+    const int64 blocks = threads*max(1, 1048576/(step*threads));
+    const int64 chunk = blocks*step;
+    vector<cfloat> data((blocks - 1)*step + size);
+    vector<float> result(chunk);
+
+    correlator work;
+    work.forward   = &forward;
+    work.inverse   = &inverse;
+    work.filter    = filter.data();
+    work.data      = data.data();
+    work.result    = result.data();
+    work.size      = size;
+    work.refs      = refs;
+    work.step      = step;
+    work.each      = size + max(forward.scratch_size(), inverse.scratch_size());
+    work.refnorm   = refnorm;
+    work.magnitude = magnitude;
+    vector<cfloat> scratch(blocks*work.each);
+    work.scratch   = scratch.data();
+
+    peaks found;
+    found.most  = count;
+    found.apart = refs;
+    float before = 0, held = 0;
+
+    int64 offset = 0;
+    while (offset < lags) {
+        int64 amount = min(chunk, lags - offset);
+
+        // the last block reads past the end, which grabcf fills with zeros
+        input.grabcf(offset, data.data(), (blocks - 1)*step + size);
+        work.lags = amount;
+        pool.parfor((amount + step - 1)/step, work);
+        output.write(result.data(), amount*sizeof(float));
+
+        // local maxima, each one decided when the lag after it arrives, so
+        // the last lag of a chunk waits for the first one of the next
+        for (int64 ll = 0; ll<amount; ll++) {
+            float val = result[ll];
+            if (offset + ll > 0 && held > before && held >= val) {
+                found.consider(offset + ll - 1, held);
+            }
+            before = held;
+            held = val;
+        }
+
+        offset += amount;
+    }
+    if (lags > 0 && held > before && held >= 0) found.consider(lags - 1, held);
+
+    for (int64 ii = 0; ii<found.where.size(); ii++) {
+        for (int64 jj = ii + 1; jj<found.where.size(); jj++) {
+            if (found.value[jj] > found.value[ii]) {
+                swap(found.value[ii], found.value[jj]);
+                swap(found.where[ii], found.where[jj]);
+            }
+        }
+    }
+    for (int64 ii = 0; ii<found.where.size(); ii++) {
+        printf(
+            "peak %lld: lag %lld (%.12lf sec), %s %lf\n", ii,
+            found.where[ii], output->xstart + found.where[ii]*output->xdelta,
+            magnitude ? "magnitude" : "coefficient", found.value[ii]
+        );
+    }
+
+    return 0;
+}
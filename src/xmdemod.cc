@@ -0,0 +1,59 @@
+#include "xmtools.h"
+using namespace xm;
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "AM, FM, and PM demodulation\n"
+        "AM is the magnitude, FM is in Hertz, and PM is in radians"
+    );
+    string mode     = args.getstring("mode", "fm", "'am', 'fm', or 'pm'");
+    bool unwrap     = args.getswitch("unwrap", "unwrap the PM phase");
+    int64 accuracy  = args.getint64("accuracy", 2, "0 for the C library, 1 to 3 for SIMD polynomials");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(mode == "am" || mode == "fm" || mode == "pm", "unknown mode '%s'", mode.data());
+    check(!unwrap || mode == "pm", "only PM can be unwrapped");
+    check(accuracy >= 0 && accuracy <= 3, "accuracy must be 0 to 3");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+    const int64 samples = input->xcount;
+
+    demod::kind kind = demod::am;
+    double scale = 1.0;
+    if (mode == "fm") {
+        kind = demod::fm;
+        scale = 1/(2*M_PI*input->xdelta);
+    }
+    if (mode == "pm") kind = unwrap ? demod::unwrapped : demod::pm;
+    demod engine(kind, accuracy, scale);
+
+    bluewriter output(outpath);
+    output->format = "SF";
+    output->time   = input->time;
+    output->xstart = input->xstart;
+    output->xdelta = input->xdelta;
+    output->xcount = samples;
+    output->xunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    const int64 block = 1048576;
+    vector<cfloat> buffer(block);
+    vector<float> result(block);
+    for (int64 offset = 0; offset<samples; offset += block) {
+        const int64 amount = min(block, samples - offset);
+        input.grabcf(offset, buffer.data(), amount);
+        engine.apply(result.data(), buffer.data(), amount);
+        output.write(result.data(), amount*sizeof(float));
+    }
+
+    return 0;
+}
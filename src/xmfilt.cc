@@ -0,0 +1,62 @@
+#include "xmtools.h"
+using namespace xm;
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "finite impulse response filter\n"
+        "applies taps from a Type 1000 file, by direct form or fast convolution"
+    );
+    string tappath  = args.getstring("taps", "Type 1000 file of real or complex taps");
+    int64 decim     = args.getint64("decim", 1, "keep every decim'th output");
+    int64 fftsize   = args.getint64("fftsize", 0, "overlap-save FFT size (0 to pick, 1 for direct form)");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(decim >= 1, "need positive decimation");
+
+    bluereader tapfile(tappath);
+    check(tapfile->type/1000 == 1, "taps must be Type 1000 file");
+    check(tapfile->xcount >= 1, "need at least one tap");
+    vector<cfloat> taps(tapfile->xcount);
+    tapfile.grabcf(0, taps.data(), taps.size());
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+
+    fastconv engine(taps, decim, fftsize);
+    const int64 samples = (input->xcount + decim - 1)/decim;
+
+    bluewriter output(outpath);
+    output->time   = input->time;
+    output->xstart = input->xstart;
+    output->xdelta = input->xdelta*decim;
+    output->xcount = samples;
+    output->xunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    const int64 block = 262144;
+    vector<cfloat> grab(block);
+    vector<cfloat> data(engine.capacity(block));
+
+    int64 offset = 0;
+    while (offset < input->xcount) {
+        int64 amount = min(block, input->xcount - offset);
+
+        input.grabcf(offset, grab.data(), amount);
+        int64 count = engine.apply(data.data(), grab.data(), amount);
+        output.write(data.data(), count*sizeof(cfloat));
+
+        offset += amount;
+    }
+    int64 count = engine.flush(data.data());
+    output.write(data.data(), count*sizeof(cfloat));
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "xmtools.h"
+using namespace xm;
+
+// A space separated list of numbers, such as "0 .2 .3 1"
+static list<double> numbers(const string& name, const string& text) {
+    list<string> words = split(text);
+    list<double> result;
+    for (int64 ii = 0; ii<words.size(); ii++) {
+        const char* ptr = words[ii].data();
+        char* end = 0;
+        const double value = strtod(ptr, &end);
+        check(end != ptr && *end == 0, "bad number '%s' in -%s", ptr, name.data());
+        result.append(value);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "finite impulse response filter design\n"
+        "equiripple linear phase taps from the Parks-McClellan algorithm, with\n"
+        "band edges as fractions of Nyquist, for instance -edges '0 .2 .3 1'"
+    );
+    int64 count     = args.getint64("taps", "number of taps");
+    string edgetext = args.getstring("edges", "band edges from 0.0 to 1.0, two per band");
+    string gaintext = args.getstring("gains", "", "gain at each band edge (default 1 for the first band, 0 for the rest)");
+    string wgttext  = args.getstring("weights", "", "error weight for each band (default 1)");
+    int64 density   = args.getint64("density", 16, "grid points per ripple");
+    int64 threads   = args.getint64("threads", 1, "number of threads");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(count >= 1, "need at least one tap");
+    check(threads >= 1, "need at least one thread");
+
+    list<double> edges = numbers("edges", edgetext);
+    check(edges.size() >= 2 && edges.size()%2 == 0, "need two edges per band");
+    const int64 bands = edges.size()/2;
+
+    list<double> gains = numbers("gains", gaintext);
+    if (gains.size() == 0) {
+        for (int64 ii = 0; ii<2*bands; ii++) {
+            gains.append(ii < 2 ? 1.0 : 0.0);
+        }
+    }
+    check(gains.size() == 2*bands, "need a gain for each band edge");
+
+    list<double> weights = numbers("weights", wgttext);
+    if (weights.size() == 0) {
+        for (int64 ii = 0; ii<bands; ii++) {
+            weights.append(1.0);
+        }
+    }
+    check(weights.size() == bands, "need a weight for each band");
+
+    threadpool pool(threads);
+    vector<double> taps(count);
+    firparks(
+        taps.data(), count, bands, edges.data(), gains.data(),
+        weights.data(), pool, density
+    );
+
+    bluewriter output(outpath);
+    output->format = "SD";
+    output->xstart = 0;
+    output->xdelta = 1;
+    output->xcount = count;
+    output.write(taps.data(), count*sizeof(double));
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "xmtools.h"
+using namespace xm;
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "complex to complex at half rate\n"
+        "decimates by 2**stages with a cascade of halfband filters"
+    );
+    int64 stages    = args.getint64("stages", 1, "number of halfband stages");
+    double percent  = args.getdouble("percent", 80, "percentage of output bandwidth to preserve");
+    int64 window    = args.getint64("firwin", 2, "FIR window for the halfbands");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(stages >= 1 && stages <= 30, "stages must be in [1, 30]");
+    check(percent > 0 && percent < 100, "percent must be in (0, 100)");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+
+    halfcascade engine(window, percent, stages);
+
+    // each stage keeps the odd sample at the end
+    int64 samples = input->xcount;
+    for (int64 ii = 0; ii<stages; ii++) {
+        samples = (samples + 1)/2;
+    }
+
+    bluewriter output(outpath);
+    output->time   = input->time;
+    output->xstart = input->xstart;
+    output->xdelta = input->xdelta*(1LL << stages);
+    output->xcount = samples;
+    output->xunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    const int64 block = 262144;
+    vector<cfloat> grab(block);
+    vector<cfloat> data(block/2 + stages + 1);
+
+    int64 offset = 0;
+    while (offset < input->xcount) {
+        int64 amount = min(block, input->xcount - offset);
+
+        input.grabcf(offset, grab.data(), amount);
+        int64 count = engine.apply(data.data(), grab.data(), amount);
+        output.write(data.data(), count*sizeof(cfloat));
+
+        offset += amount;
+    }
+    int64 count = engine.flush(data.data());
+    output.write(data.data(), count*sizeof(cfloat));
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+#include "xmtools.h"
+using namespace xm;
+
+//
+// Rows come straight out of the mmap for native SF files, and the pages
+// are dropped once the scan is past them, so the file can be much bigger
+// than memory.  Other formats and pipes are converted into a rolling
+// buffer a chunk of rows at a time.  A Type 1000 file is scanned as rows
+// of a fixed width, with the last sample of each row next to the first
+// sample of the following one.
+//
+struct surface {
+    bluereader* input;
+    int64 cols, rows, count;
+    bool oned, direct, cplx;
+    const float* base;
+    int64 released;        // rows whose pages were dropped
+    int64 first, have;     // rows in the buffer
+    vector<float> buffer;
+    vector<cfloat> convert;
+
+    const float* row(int64 rr) const {
+        if (direct) return base + rr*cols;
+        return buffer.data() + (rr - first)*cols;
+    }
+
+    int64 width(int64 rr) const {
+        return oned ? min(cols, count - rr*cols) : cols;
+    }
+
+    // Anything off the edge is -inf, so it never beats a peak
+    float value(int64 rr, int64 cc) const {
+        if (oned) {
+            int64 index = rr*cols + cc;
+            if (index < 0 || index >= count) return -HUGE_VALF;
+            return row(index/cols)[index%cols];
+        }
+        if (rr < 0 || rr >= rows || cc < 0 || cc >= cols) return -HUGE_VALF;
+        return row(rr)[cc];
+    }
+
+    // Makes rows [lo, hi) available, and neither one goes backwards
+    void load(int64 lo, int64 hi) {
+        if (direct) {
+            const int64 page = sysconf(_SC_PAGESIZE);
+            uintptr_t start = (uintptr_t)(base + released*cols);
+            uintptr_t stop = (uintptr_t)(base + lo*cols);
+            start = (start + page - 1)/page*page;
+            stop = stop/page*page;
+            if (start < stop) madvise((void*)start, stop - start, MADV_DONTNEED);
+            released = lo;
+            return;
+        }
+
+        int64 keep = max(first + have - lo, (int64)0);
+        float* data = buffer.data();
+        memmove(data, data + (have - keep)*cols, keep*cols*sizeof(float));
+        first = lo;
+        have = keep;
+
+        const int64 more = hi - first - have;
+        const int64 offset = (first + have)*cols;
+        const int64 amount = min(more*cols, count - offset);
+        if (amount <= 0) return;
+        input->grabcf(offset, convert.data(), amount);
+        float* dst = data + have*cols;
+        for (int64 ii = 0; ii<amount; ii++) {
+            dst[ii] = cplx ? mag(convert[ii]) : convert[ii].re;
+        }
+        have += more;
+    }
+};
+
+// The neighbors are saved for the refinement, since the rows around a
+// peak are long gone by the end of the scan
+struct peak {
+    int64 row, col;
+    float value;
+    float left, right, above, below;
+};
+
+// The largest local maxima, with the smaller of any two close ones dropped
+struct peaks {
+    int64 most, xsep, ysep, cols;
+    bool oned;
+    float threshold;
+    list<peak> kept;
+
+    bool near(const peak& aa, const peak& bb) const {
+        if (oned) {
+            return llabs((aa.row - bb.row)*cols + aa.col - bb.col) <= xsep;
+        }
+        return llabs(aa.row - bb.row) <= ysep && llabs(aa.col - bb.col) <= xsep;
+    }
+
+    // Values below this can't make it into the list
+    float floor() const {
+        if (kept.size() < most) return threshold;
+        float low = kept[0].value;
+        for (int64 ii = 1; ii<kept.size(); ii++) {
+            low = min(low, kept[ii].value);
+        }
+        return max(low, threshold);
+    }
+
+    void consider(const peak& pp) {
+        if (most == 0) return;
+        for (int64 ii = 0; ii<kept.size(); ii++) {
+            if (near(kept[ii], pp) && kept[ii].value >= pp.value) return;
+        }
+        for (int64 ii = kept.size() - 1; ii >= 0; ii--) {
+            if (near(kept[ii], pp)) kept.remove(ii);
+        }
+        if (kept.size() < most) {
+            kept.append(pp);
+            return;
+        }
+        int64 low = 0;
+        for (int64 ii = 1; ii<kept.size(); ii++) {
+            if (kept[ii].value < kept[low].value) low = ii;
+        }
+        if (pp.value > kept[low].value) kept[low] = pp;
+    }
+};
+
+// Earlier neighbors have to be smaller and later ones no bigger, so a
+// plateau has exactly one peak
+static bool islocal(const surface& surf, int64 rr, int64 cc, float val) {
+    if (!(val > surf.value(rr, cc - 1) && val >= surf.value(rr, cc + 1))) {
+        return false;
+    }
+    if (surf.oned) return true;
+    for (int64 dc = -1; dc <= 1; dc++) {
+        if (!(val > surf.value(rr - 1, cc + dc))) return false;
+        if (!(val >= surf.value(rr + 1, cc + dc))) return false;
+    }
+    return true;
+}
+
+static void scan(const surface& surf, peaks& found, int64 rr) {
+    const float* src = surf.row(rr);
+    const int64 width = surf.width(rr);
+    float limit = found.floor();
+
+    // skip 16 values at a time when none of them could make the list
+    int64 cc = 0;
+    for (;;) {
+        int64 stop = width;
+        for (; cc + 16 <= width; cc += 16) {
+            f32x4 most = simdmax(
+                simdmax(simdload<f32x4>(src + cc + 0), simdload<f32x4>(src + cc + 4)),
+                simdmax(simdload<f32x4>(src + cc + 8), simdload<f32x4>(src + cc + 12))
+            );
+            float big = max(max(most[0], most[1]), max(most[2], most[3]));
+            if (big >= limit) {
+                stop = cc + 16;
+                break;
+            }
+        }
+        if (cc >= width) break;
+        for (; cc<stop; cc++) {
+            const float val = src[cc];
+            if (!(val >= limit) || !islocal(surf, rr, cc, val)) continue;
+            peak pp = {
+                rr, cc, val,
+                surf.value(rr, cc - 1), surf.value(rr, cc + 1),
+                surf.value(rr - 1, cc), surf.value(rr + 1, cc)
+            };
+            found.consider(pp);
+            limit = found.floor();
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "pick peaks\n"
+        "finds the largest local maxima in a Type 1000 or 2000 file, such as\n"
+        "xmcorl or xmcaf output, and prints them as JSON"
+    );
+    int64 count      = args.getint64("count", 10, "number of peaks to report");
+    double threshold = args.getdouble("threshold", -HUGE_VAL, "smallest value to report");
+    int64 xsep       = args.getint64("xsep", 2, "columns from a bigger peak that are suppressed");
+    int64 ysep       = args.getint64("ysep", 2, "rows from a bigger peak that are suppressed");
+    string inpath    = args.getinput("input.tmp", "input blue file");
+    args.done();
+
+    check(count >= 0, "need non-negative count");
+    check(xsep >= 0 && ysep >= 0, "need non-negative separations");
+
+    bluereader input(inpath);
+    const int64 type = input->type/1000;
+    check(type == 1 || type == 2, "must be Type 1000 or 2000 file");
+
+    surface surf;
+    surf.input = &input;
+    surf.oned = type == 1;
+    surf.count = input->xcount*(surf.oned ? 1 : input->ycount);
+    surf.cols = surf.oned ? 16384 : input->xcount;
+    surf.rows = (surf.count + surf.cols - 1)/surf.cols;
+    surf.cplx = input->format.data()[0] == 'C';
+    surf.direct = input->format == "SF" && !input.is_swapped() && input.is_file();
+    surf.base = 0;
+    surf.released = 0;
+    surf.first = 0;
+    surf.have = 0;
+    check(surf.count >= 1, "need a non-empty file");
+
+    // a few MB of rows at a time
+    const int64 chunk = max((int64)1, 1048576/surf.cols);
+    if (surf.direct) {
+        surf.base = (const float*)input.mmap();
+        const int64 page = sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)surf.base/page*page;
+        madvise((void*)start, (uintptr_t)(surf.base + surf.count) - start, MADV_SEQUENTIAL);
+    } else {
+        surf.buffer.resize((chunk + 2)*surf.cols);
+        surf.convert.resize((chunk + 2)*surf.cols);
+    }
+
+    peaks found;
+    found.most = count;
+    found.xsep = xsep;
+    found.ysep = ysep;
+    found.cols = surf.cols;
+    found.oned = surf.oned;
+    found.threshold = threshold;
+
+    for (int64 lo = 0; lo<surf.rows; lo += chunk) {
+        const int64 hi = min(lo + chunk, surf.rows);
+        surf.load(max(lo - 1, (int64)0), min(hi + 1, surf.rows));
+        for (int64 rr = lo; rr<hi; rr++) {
+            scan(surf, found, rr);
+        }
+    }
+
+    // biggest first
+    list<peak>& kept = found.kept;
+    for (int64 ii = 0; ii<kept.size(); ii++) {
+        for (int64 jj = ii + 1; jj<kept.size(); jj++) {
+            if (kept[jj].value > kept[ii].value) swap(kept[ii], kept[jj]);
+        }
+    }
+
+    // refine each axis with a parabola through the neighbors
+    printf("[\n");
+    for (int64 ii = 0; ii<kept.size(); ii++) {
+        const peak& pp = kept[ii];
+        double value = pp.value;
+        double dx = 0, dy = 0;
+        if (pp.left != -HUGE_VALF && pp.right != -HUGE_VALF) {
+            dx = quadpeak(pp.left, pp.value, pp.right);
+            value -= .25*(pp.left - pp.right)*dx;
+        }
+        if (!surf.oned && pp.above != -HUGE_VALF && pp.below != -HUGE_VALF) {
+            dy = quadpeak(pp.above, pp.value, pp.below);
+            value -= .25*(pp.above - pp.below)*dy;
+        }
+
+        if (surf.oned) {
+            const int64 index = pp.row*surf.cols + pp.col;
+            printf(
+                "  { \"value\": %.9lg, \"x\": %.18lf, \"index\": %lld }%s\n",
+                value, input->xstart + (index + dx)*input->xdelta,
+                index, ii + 1 < kept.size() ? "," : ""
+            );
+        } else {
+            printf(
+                "  { \"value\": %.9lg, \"x\": %.18lf, \"y\": %.18lf, \"col\": %lld, \"row\": %lld }%s\n",
+                value, input->xstart + (pp.col + dx)*input->xdelta,
+                input->ystart + (pp.row + dy)*input->ydelta,
+                pp.col, pp.row, ii + 1 < kept.size() ? "," : ""
+            );
+        }
+    }
+    printf("]\n");
+
+    return 0;
+}
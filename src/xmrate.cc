@@ -1,6 +1,35 @@
 #include "xmtools.h"
 using namespace xm;
 
+// Each chunk of 1024 output samples computes the span of input it needs
+// from its own offset, exactly as the serial loop did, so the results are
+// bit-identical no matter how many threads share the work.  The input for
+// a whole batch of chunks is grabbed up front by the main thread.
+struct resampler {
+    const polyphase* pp;
+    timecode tstart, tbegin;
+    double xdelta, inrate;
+    int64 taps;
+    int64 batch_offset, batch_length;
+    int64 super_lo;
+    const cfloat* grab;
+    cfloat* data;
+
+    void operator ()(int64 index) {
+        int64 offset = batch_offset + index*1024;
+        int64 amount = min(1024, batch_offset + batch_length - offset);
+
+        double want_lo = (tstart + xdelta*offset - tbegin)*inrate;
+        double want_hi = (tstart + xdelta*(offset + amount) - tbegin)*inrate;
+        int64 grab_lo = (int64)floor(want_lo - taps/2);
+
+        pp->resample(
+            data + index*1024, amount, grab + (grab_lo - super_lo),
+            want_lo - grab_lo, want_hi - grab_lo
+        );
+    }
+};
+
 int main(int argc, char* argv[]) {
 
     cmdline args(argc, argv, "resample data to a new rate");
@@ -10,12 +39,16 @@ int main(int argc, char* argv[]) {
     double outrate  = args.getdouble("rate", "output sample rate");
     double percent  = args.getdouble("percent", 80, "percentage of bandwidth to preserve");
     int64 window    = args.getint64("firwin", 2, "FIR window for resampling");
+    int64 threads   = args.getint64("threads", 1, "number of threads for resampling");
+    string cache    = args.getstring("cache", getenv("XMCACHE") ? getenv("XMCACHE") : "",
+                                     "directory to cache filter banks (default $XMCACHE)");
     bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
     string inpath      = args.getinput("input.tmp", "input blue file");
     string outpath     = args.getoutput("output.tmp", "output blue file");
     args.done();
 
     check(outrate > 0, "need positive sample rate");
+    check(threads >= 1, "need at least one thread");
 
     bluereader input(inpath);
     check(input->type/1000 == 1, "must be Type 1000 file");
@@ -36,7 +69,7 @@ int main(int argc, char* argv[]) {
     double dwidth = min(percent * .01 * outrate / inrate, 1);
     int64 taps = (int64)ceil(8 * apodize(window) / dwidth);
     if (taps%2) taps += 1;
-    polyphase pp(window, dwidth, taps);
+    polyphase pp(window, dwidth, taps, cache);
 
     const int64 samples = llrint(outrate*tspan);
 
@@ -54,24 +87,49 @@ int main(int argc, char* argv[]) {
         output->kwds = input->kwds;
     }
 
-    vector<cfloat> data(1024);
+    // Enough chunks per batch to keep every thread busy, but small
+    // enough that the input and output buffers stay modest when
+    // decimating by large ratios.
+    const double chunk_input = 1024*inrate/outrate + taps;
+    const int64 chunks = max(threads, min(16*threads, (int64)(4194304/chunk_input)));
+    const int64 batch = 1024*chunks;
+    threadpool pool(threads);
+    vector<cfloat> data(batch);
     vector<cfloat> grab;
+
+    resampler work;
+    work.pp = &pp;
+    work.tstart = tstart;
+    work.tbegin = tbegin;
+    work.xdelta = xdelta;
+    work.inrate = inrate;
+    work.taps = taps;
+    work.data = data.data();
+
     int64 offset = 0;
     while (offset < samples) {
-        int64 amount = min(1024, samples - offset);
+        int64 amount = min(batch, samples - offset);
 
-        double want_lo = (tstart + xdelta*offset - tbegin)*inrate;
-        double want_hi = (tstart + xdelta*(offset + amount) - tbegin)*inrate;
-        int64 grab_lo = (int64)floor(want_lo - taps/2);
-        int64 grab_hi = (int64) ceil(want_hi + taps/2);
+        // find the span of input needed by all the chunks in this batch
+        int64 grab_lo = INT64_MAX;
+        int64 grab_hi = INT64_MIN;
+        for (int64 chunk = offset; chunk < offset + amount; chunk += 1024) {
+            int64 count = min(1024, offset + amount - chunk);
+            double want_lo = (tstart + xdelta*chunk - tbegin)*inrate;
+            double want_hi = (tstart + xdelta*(chunk + count) - tbegin)*inrate;
+            grab_lo = min(grab_lo, (int64)floor(want_lo - taps/2));
+            grab_hi = max(grab_hi, (int64) ceil(want_hi + taps/2));
+        }
         int64 grab_len = grab_hi - grab_lo;
         if (grab.size() < grab_len) grab.resize(2*grab_len);
 
         input.grabcf(grab_lo, grab.data(), grab_len);
-        pp.resample(
-            data.data(), amount, grab.data(), 
-            want_lo - grab_lo, want_hi - grab_lo
-        );
+
+        work.batch_offset = offset;
+        work.batch_length = amount;
+        work.super_lo = grab_lo;
+        work.grab = grab.data();
+        pool.parfor((amount + 1023)/1024, work);
 
         output.write(data.data(), amount*sizeof(cfloat));
 
@@ -0,0 +1,142 @@
+#include "xmtools.h"
+using namespace xm;
+
+// Each index is one share of the segments in a block, with its own scratch
+// space and sums.  The shares are the same for every block, so the results
+// don't depend on which thread ran what.
+struct welch {
+    const kissfft<float>* plan;
+    const realfft<float>* rplan;
+    const cfloat* data;
+    const float* window;
+    int64 size, hop, bins, share, segments, each;
+    cfloat* scratch;
+    double* sums;
+
+    void operator ()(int64 index) {
+        int64 lo = index*share;
+        int64 hi = min(lo + share, segments);
+        cfloat* buffer = scratch + index*each;
+        cfloat* freq = buffer + size;
+        cfloat* work = freq + size;
+        double* sum = sums + index*bins;
+        for (int64 ss = lo; ss<hi; ss++) {
+            const cfloat* src = data + ss*hop;
+            if (rplan) {
+                float* real = (float*)buffer;
+                for (int64 ii = 0; ii<size; ii++) {
+                    real[ii] = src[ii].re*window[ii];
+                }
+                rplan->exec(freq, real, work);
+            } else {
+                for (int64 ii = 0; ii<size; ii++) {
+                    buffer[ii] = src[ii]*window[ii];
+                }
+                plan->exec(freq, buffer, work);
+            }
+            for (int64 kk = 0; kk<bins; kk++) {
+                sum[kk] += mag2(freq[kk]);
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "power spectral density\n"
+        "averages windowed FFTs of overlapping segments (Welch's method)"
+    );
+    int64 size      = args.getint64("size", 1024, "FFT size");
+    double overlap  = args.getdouble("overlap", 50, "percentage of overlap between segments");
+    int64 window    = args.getint64("firwin", 2, "FIR window for the segments");
+    int64 threads   = args.getint64("threads", 1, "number of threads for the FFTs");
+    bool linear     = args.getswitch("linear", "write power instead of dB");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(size >= 2 && size%2 == 0, "need an even FFT size");
+    check(overlap >= 0 && overlap < 100, "overlap must be in [0, 100)");
+    check(threads >= 1, "need at least one thread");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+    check(input->xcount >= size, "need at least %lld samples", size);
+
+    // real input only needs the non-negative frequencies
+    const bool real = input->format.data()[0] == 'S';
+    const int64 bins = real ? size/2 + 1 : size;
+    const int64 hop = max(1, llrint(size*(1 - overlap*.01)));
+    const int64 segments = (input->xcount - size)/hop + 1;
+    const double rate = 1/input->xdelta;
+
+    vector<float> taper(size);
+    double power = 0;
+    for (int64 ii = 0; ii<size; ii++) {
+        taper[ii] = firwin(window, ii - size/2, size);
+        power += taper[ii]*taper[ii];
+    }
+
+    kissfft<float> plan(size);
+    realfft<float> rplan(size);
+
+    bluewriter output(outpath);
+    output->format = "SF";
+    output->time   = input->time;
+    output->xstart = real ? 0 : -(size/2)*rate/size;
+    output->xdelta = rate/size;
+    output->xcount = bins;
+    output->xunits = blueunits::freq;
+
+    // Blocks of segments are a few MB of input, with at least one
+    // segment for every thread
+    threadpool pool(threads);
+    const int64 block = max(threads, 1048576/hop);
+    const int64 shares = threads;
+    const int64 each = 2*size + max(plan.scratch_size(), rplan.scratch_size());
+    vector<cfloat> grab((block - 1)*hop + size);
+    vector<cfloat> scratch(shares*each);
+    vector<double> sums(shares*bins, 0.0);
+
+    welch work;
+    work.plan     = &plan;
+    work.rplan    = real ? &rplan : 0;
+    work.data     = grab.data();
+    work.window   = taper.data();
+    work.size     = size;
+    work.hop      = hop;
+    work.bins     = bins;
+    work.each     = each;
+    work.scratch  = scratch.data();
+    work.sums     = sums.data();
+
+    int64 offset = 0;
+    while (offset < segments) {
+        int64 amount = min(block, segments - offset);
+
+        input.grabcf(offset*hop, grab.data(), (amount - 1)*hop + size);
+        work.segments = amount;
+        work.share = (amount + shares - 1)/shares;
+        pool.parfor(shares, work);
+
+        offset += amount;
+    }
+
+    // Density per Hz, with the power from the negative frequencies
+    // folded into the positive ones for real input
+    vector<float> psd(bins);
+    for (int64 kk = 0; kk<bins; kk++) {
+        double total = 0;
+        for (int64 ii = 0; ii<shares; ii++) {
+            total += sums[ii*bins + kk];
+        }
+        total /= segments*power*rate;
+        if (real && kk != 0 && kk != size/2) total *= 2;
+        psd[kk] = linear ? total : 10*log10(total + 1e-30);
+    }
+    if (!real) hshift(psd.data(), 1, size, (size + 1)/2);
+    output.write(psd.data(), bins*sizeof(float));
+
+    return 0;
+}
@@ -2,6 +2,252 @@
 #include "xm/printkwd.h"
 using namespace xm;
 
+// Neumaier's compensated sum, which keeps the bits that fall off the
+// bottom of the running total in a separate correction
+static inline void compensated(double& sum, double& comp, double val) {
+    double total = sum + val;
+    if (fabs(sum) >= fabs(val)) {
+        comp += (sum - total) + val;
+    } else {
+        comp += (val - total) + sum;
+    }
+    sum = total;
+}
+
+struct summary {
+    int64 count, clipped;
+    double sum[2], sumc[2];
+    double power, powerc;
+    float lo[2], hi[2];
+    int64 hist[1024];   // mag squared in four linear steps per octave
+    int64 zeros;        // exact zero power, which has no place in dB
+    int64 nonfinite;    // inf and NaN, which have no place at all
+
+    void clear() {
+        count = clipped = 0;
+        sum[0] = sum[1] = sumc[0] = sumc[1] = 0;
+        power = powerc = 0;
+        lo[0] = lo[1] = HUGE_VALF;
+        hi[0] = hi[1] = -HUGE_VALF;
+        memset(hist, 0, sizeof(hist));
+        zeros = nonfinite = 0;
+    }
+
+    void merge(const summary& other) {
+        count += other.count;
+        clipped += other.clipped;
+        for (int ii = 0; ii<2; ii++) {
+            compensated(sum[ii], sumc[ii], other.sum[ii]);
+            compensated(sum[ii], sumc[ii], other.sumc[ii]);
+            lo[ii] = min(lo[ii], other.lo[ii]);
+            hi[ii] = max(hi[ii], other.hi[ii]);
+        }
+        compensated(power, powerc, other.power);
+        compensated(power, powerc, other.powerc);
+        for (int64 ii = 0; ii<1024; ii++) {
+            hist[ii] += other.hist[ii];
+        }
+        zeros += other.zeros;
+        nonfinite += other.nonfinite;
+    }
+};
+
+//
+// Each index converts and reduces one share of a chunk into its own
+// summary, so the threads never touch the same memory.  The reductions
+// keep the real parts in lanes 0 and 2 and the imaginary parts in lanes 1
+// and 3.  Groups of 32 samples are summed in float SIMD registers, and
+// each group's total goes into a compensated double sum.
+//
+struct tally {
+    const char* raw;
+    string format;
+    bool swapped, clipping, histogram;
+    int64 itemsize, count, share;
+    float cliplo, cliphi;
+    summary* results;
+    cfloat* samples;   // share per index
+    char* bytes;       // share*itemsize per index, when swapped
+
+    void operator ()(int64 index) {
+        summary& res = results[index];
+        res.clear();
+        const int64 lo = index*share;
+        const int64 len = min(share, count - lo);
+        if (len <= 0) return;
+
+        // byte swapping happens in place, so it needs a copy
+        cfloat* data = samples + index*share;
+        void* src = (void*)(raw + lo*itemsize);
+        if (swapped) {
+            char* copy = bytes + index*share*itemsize;
+            memcpy(copy, src, len*itemsize);
+            src = copy;
+        }
+        internal::convertcf(format, swapped, src, data, len);
+
+        const float* ptr = (const float*)data;
+        const f32x4 zero = { 0, 0, 0, 0 };
+        const f32x4 low = { cliplo, cliplo, cliplo, cliplo };
+        const f32x4 high = { cliphi, cliphi, cliphi, cliphi };
+        f32x4 small = { HUGE_VALF, HUGE_VALF, HUGE_VALF, HUGE_VALF };
+        f32x4 large = -small;
+        i32x4 clips = { 0, 0, 0, 0 };
+        int64 ii = 0;
+        for (; ii + 32 <= len; ii += 32) {
+            f32x4 sum = zero, pow = zero;
+            for (int64 jj = 0; jj<64; jj += 4) {
+                f32x4 val = simdload<f32x4>(ptr + 2*ii + jj);
+                sum += val;
+                pow += val*val;
+                small = simdmin(small, val);
+                large = simdmax(large, val);
+                if (clipping) clips -= (val <= low) | (val >= high);
+            }
+            compensated(res.sum[0], res.sumc[0], sum[0] + sum[2]);
+            compensated(res.sum[1], res.sumc[1], sum[1] + sum[3]);
+            compensated(res.power, res.powerc, (pow[0] + pow[1]) + (pow[2] + pow[3]));
+        }
+        for (; ii<len; ii++) {
+            const float re = data[ii].re, im = data[ii].im;
+            compensated(res.sum[0], res.sumc[0], re);
+            compensated(res.sum[1], res.sumc[1], im);
+            compensated(res.power, res.powerc, re*re + im*im);
+            res.lo[0] = min(res.lo[0], re);
+            res.lo[1] = min(res.lo[1], im);
+            res.hi[0] = max(res.hi[0], re);
+            res.hi[1] = max(res.hi[1], im);
+            if (clipping) {
+                res.clipped += (re <= cliplo || re >= cliphi);
+                res.clipped += (im <= cliplo || im >= cliphi);
+            }
+        }
+        res.lo[0] = min(res.lo[0], min(small[0], small[2]));
+        res.lo[1] = min(res.lo[1], min(small[1], small[3]));
+        res.hi[0] = max(res.hi[0], max(large[0], large[2]));
+        res.hi[1] = max(res.hi[1], max(large[1], large[3]));
+        res.clipped += clips[0] + clips[1] + clips[2] + clips[3];
+        res.count = len;
+
+        // the exponent and the top two mantissa bits, with the sign
+        // cleared since a NaN can have it set
+        if (histogram) {
+            for (int64 kk = 0; kk<len; kk++) {
+                float pp = mag2(data[kk]);
+                uint32_t bits;
+                memcpy(&bits, &pp, sizeof(bits));
+                bits &= 0x7fffffff;
+                if (bits == 0) res.zeros++;
+                else if (bits >= 0x7f800000) res.nonfinite++;
+                else res.hist[bits >> 21]++;
+            }
+        }
+    }
+};
+
+// One pass over all of the samples, a few MB per thread at a time
+static summary scan(bluereader& input, int64 threads, bool histogram) {
+    const string format = input->format;
+    const int64 itemsize = input->itemsize;
+    const int64 total = input->type/1000 == 2 ? input->xcount*input->ycount : input->xcount;
+    const char kind = input->format.data()[1];
+
+    tally work;
+    work.format    = format;
+    work.swapped   = input.is_swapped();
+    work.itemsize  = itemsize;
+    work.histogram = histogram;
+    work.clipping  = kind == 'B' || kind == 'I' || kind == 'L';
+    work.cliplo    = kind == 'B' ? -128 : kind == 'I' ? -32768 : -2147483648.0;
+    work.cliphi    = kind == 'B' ? 127 : kind == 'I' ? 32767 : 2147483647.0;
+
+    const int64 share = 262144;
+    const int64 chunk = share*threads;
+    vector<summary> results(threads);
+    vector<cfloat> samples(chunk);
+    vector<char> bytes(work.swapped ? chunk*itemsize : 0);
+    vector<char> buffer;
+    work.results = results.data();
+    work.samples = samples.data();
+    work.bytes   = bytes.data();
+    work.share   = share;
+
+    // regular files are read straight from the mmap, pipes are copied
+    const char* base = 0;
+    if (input.is_file()) {
+        base = (const char*)input.mmap();
+        const int64 page = sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)base/page*page;
+        madvise((void*)start, (uintptr_t)(base + total*itemsize) - start, MADV_SEQUENTIAL);
+    } else {
+        buffer.resize(chunk*itemsize);
+    }
+
+    threadpool pool(threads);
+    summary result;
+    result.clear();
+    for (int64 offset = 0; offset<total; offset += chunk) {
+        work.count = min(chunk, total - offset);
+        if (base) {
+            work.raw = base + offset*itemsize;
+        } else {
+            input.grab(offset*itemsize, buffer.data(), work.count*itemsize);
+            work.raw = buffer.data();
+        }
+        pool.parfor(threads, work);
+        for (int64 ii = 0; ii<threads; ii++) {
+            result.merge(results[ii]);
+        }
+    }
+    return result;
+}
+
+static void printdata(const summary& res, bool cplx, bool clipping, bool histogram, bool more) {
+    const double count = max(res.count, (int64)1);
+    const double power = (res.power + res.powerc)/count;
+    printf("  \"data\"   : {\n");
+    printf("    \"count\"   : %lld,\n", res.count);
+    if (cplx) {
+        printf("    \"mean\"    : [%.9le, %.9le],\n", (res.sum[0] + res.sumc[0])/count, (res.sum[1] + res.sumc[1])/count);
+        printf("    \"min\"     : [%.9le, %.9le],\n", res.lo[0], res.lo[1]);
+        printf("    \"max\"     : [%.9le, %.9le],\n", res.hi[0], res.hi[1]);
+    } else {
+        printf("    \"mean\"    : %.9le,\n", (res.sum[0] + res.sumc[0])/count);
+        printf("    \"min\"     : %.9le,\n", res.lo[0]);
+        printf("    \"max\"     : %.9le,\n", res.hi[0]);
+    }
+    if (clipping) {
+        printf("    \"clipped\" : %lld,\n", res.clipped);
+    }
+    printf("    \"rms\"     : %.9le,\n", sqrt(power));
+    printf("    \"power\"   : %.9le,\n", power);
+    printf("    \"powerdb\" : %.6lf%s\n", 10*log10(power + 1e-300), histogram ? "," : "");
+    if (histogram) {
+        printf("    \"zeros\"     : %lld,\n", res.zeros);
+        printf("    \"nonfinite\" : %lld,\n", res.nonfinite);
+        // the lower edge of each bin in dB, at 1, 1.25, 1.5, and 1.75
+        // times a power of two, and the first bin starts at the smallest
+        // denormal since zeros are counted on their own
+        int64 last = -1;
+        for (int64 ii = 0; ii<1024; ii++) {
+            if (res.hist[ii]) last = ii;
+        }
+        printf("    \"histogram\" : [\n");
+        for (int64 ii = 0; ii<=last; ii++) {
+            if (res.hist[ii] == 0) continue;
+            uint32_t bits = max((uint32_t)ii << 21, (uint32_t)1);
+            float edge;
+            memcpy(&edge, &bits, sizeof(edge));
+            printf(
+                "      { \"db\": %.3lf, \"count\": %lld }%s\n",
+                10*log10(edge + 1e-300), res.hist[ii], ii == last ? "" : ","
+            );
+        }
+        printf("    ]\n");
+    }
+    printf("  }%s\n", more ? "," : "");
+}
+
 int main(int argc, char* argv[]) {
     using namespace internal;
 
@@ -12,10 +258,19 @@ int main(int argc, char* argv[]) {
     );
 
     bool kwds     = args.getswitch("kwds", "include the keywords");
+    bool data     = args.getswitch("data", "include statistics from a pass over the data");
+    bool hist     = args.getswitch("hist", "include a power histogram with the data statistics");
+    int64 threads = args.getint64("threads", 1, "number of threads for the data statistics");
     string inpath = args.getinput("input.tmp", "input BLUE file");
     args.done();
 
+    check(threads >= 1, "need at least one thread");
+    check(!hist || data, "the histogram needs -data");
+
     bluereader input(inpath);
+    const int kind = input->type/1000;
+    check(!data || kind == 1 || kind == 2, "data statistics need a Type 1000 or 2000 file");
+    const bool more = kwds || data;
 
     printf("{\n");
     printf("  \"time\"   : \"%s\",\n",   format(input->time, 12).data());;
@@ -31,7 +286,7 @@ int main(int argc, char* argv[]) {
         printf("  \"xspan\"  : %.18lf,\n", input->xdelta*input->xcount);
         printf("  \"xcount\" : %lld,\n", (long long)input->xcount);
         printf("  \"xunits\" : \"%s\",\n", xmunits(input->xunits).data());
-        printf("  \"xbytes\" : %lld%s\n", bytesize, kwds ? "," : "");
+        printf("  \"xbytes\" : %lld%s\n", bytesize, more ? "," : "");
     }
 
     if (input->type/1000 == 2) {
@@ -48,7 +303,7 @@ int main(int argc, char* argv[]) {
         printf("  \"yspan\"  : %.18lf,\n", input->ydelta*input->ycount);
         printf("  \"ycount\" : %lld,\n", (long long)input->ycount);
         printf("  \"ybytes\" : %lld,\n", bytesize*input->xcount);
-        printf("  \"yunits\" : \"%s\"%s\n", xmunits(input->yunits).data(), kwds ? "," : "");
+        printf("  \"yunits\" : \"%s\"%s\n", xmunits(input->yunits).data(), more ? "," : "");
     }
 
     if (input->type/1000 == 3 || input->type/1000 == 5) {
@@ -71,6 +326,15 @@ int main(int argc, char* argv[]) {
         printf("  ]%s\n", kwds ? "," : "");
     }
 
+    if (data) {
+        const char size = input->format.data()[1];
+        summary res = scan(input, threads, hist);
+        printdata(
+            res, input->format.data()[0] == 'C',
+            size == 'B' || size == 'I' || size == 'L', hist, kwds
+        );
+    }
+
     if (kwds) {
         printf("  \"kwds\": [\n");
         for (int64 ii = 0; ii<(int64)input->kwds.storage.size(); ii++) {
@@ -0,0 +1,235 @@
+#include "xmtools.h"
+using namespace xm;
+
+//
+// The tool is a three stage pipeline: a reader thread fills frames of
+// input, the main thread does the FFTs (split across a threadpool), and a
+// writer thread writes the rows out.  A fixed number of frames circulate
+// between the stages, so memory stays bounded no matter how long the
+// input is, and a null frame marks the end.
+//
+struct frame {
+    int64 row, rows;
+    vector<cfloat> input;
+    vector<float> output;
+};
+
+struct pipeline {
+    queue<frame*> empty, full, done;
+    bluereader* input;
+    bluewriter* output;
+    int64 hop, size, average, rows, block, width;
+};
+
+static void* reader(void* arg) {
+    pipeline& pipe = *(pipeline*)arg;
+    try {
+        for (int64 row = 0; row<pipe.rows; row += pipe.block) {
+            frame* fr = pipe.empty.pull();
+            fr->row = row;
+            fr->rows = min(pipe.block, pipe.rows - row);
+            const int64 segments = fr->rows*pipe.average;
+            pipe.input->grabcf(
+                row*pipe.average*pipe.hop, fr->input.data(), (segments - 1)*pipe.hop + pipe.size
+            );
+            pipe.full.push(fr);
+        }
+    } catch (const std::exception& err) {
+        fprintf(stderr, "Error: %s\n", err.what());
+        exit(1);
+    }
+    pipe.full.push(0);
+    return 0;
+}
+
+static void* writer(void* arg) {
+    pipeline& pipe = *(pipeline*)arg;
+    try {
+        for (;;) {
+            frame* fr = pipe.done.pull();
+            if (fr == 0) break;
+            pipe.output->write(fr->output.data(), fr->rows*pipe.width*sizeof(float));
+            pipe.empty.push(fr);
+        }
+    } catch (const std::exception& err) {
+        fprintf(stderr, "Error: %s\n", err.what());
+        exit(1);
+    }
+    return 0;
+}
+
+// Each index is one share of the rows in a frame with its own scratch space
+struct spectra {
+    const kissfft<float>* plan;
+    const float* window;
+    frame* fr;
+    int64 size, hop, average, share, each;
+    bool cplx, decibels;
+    double scale;
+    cfloat* scratch;
+
+    void operator ()(int64 index) {
+        int64 lo = index*share;
+        int64 hi = min(lo + share, fr->rows);
+        cfloat* buffer = scratch + index*each;
+        cfloat* freq = buffer + size;
+        cfloat* work = freq + size;
+        float* power = (float*)(work + plan->scratch_size());
+        for (int64 rr = lo; rr<hi; rr++) {
+            for (int64 kk = 0; kk<size; kk++) power[kk] = 0;
+            for (int64 aa = 0; aa<average; aa++) {
+                const cfloat* src = fr->input.data() + (rr*average + aa)*hop;
+                for (int64 ii = 0; ii<size; ii++) {
+                    buffer[ii] = src[ii]*window[ii];
+                }
+                plan->exec(freq, buffer, work);
+                if (cplx) break;
+                for (int64 kk = 0; kk<size; kk++) {
+                    power[kk] += mag2(freq[kk]);
+                }
+            }
+
+            if (cplx) {
+                cfloat* dst = (cfloat*)fr->output.data() + rr*size;
+                for (int64 kk = 0; kk<size; kk++) {
+                    dst[kk] = freq[kk]*(float)scale;
+                }
+                continue;
+            }
+            float* dst = fr->output.data() + rr*size;
+            for (int64 kk = 0; kk<size; kk++) {
+                double val = power[kk]*scale*scale/average;
+                dst[kk] = decibels ? 10*log10(val + 1e-30) : val;
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "short time Fourier transform\n"
+        "makes a Type 2000 spectrogram with one row per hop"
+    );
+    int64 size      = args.getint64("size", 1024, "FFT size");
+    int64 hop       = args.getint64("hop", 0, "samples between FFTs (0 for the FFT size)");
+    int64 average   = args.getint64("average", 1, "number of FFTs averaged into each row");
+    int64 window    = args.getint64("firwin", 2, "FIR window for the FFTs");
+    string mode     = args.getstring("mode", "db", "output 'db', 'sf' (power), or 'cf' (complex)");
+    int64 threads   = args.getint64("threads", 1, "number of threads for the FFTs");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    if (hop == 0) hop = size;
+    check(size >= 1, "need positive FFT size");
+    check(hop >= 1, "need positive hop");
+    check(average >= 1, "need positive average");
+    check(threads >= 1, "need at least one thread");
+    check(mode == "db" || mode == "sf" || mode == "cf", "unknown mode '%s'", mode.data());
+    check(mode != "cf" || average == 1, "can't average complex rows");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+    check(input->xcount >= size, "need at least %lld samples", size);
+
+    const int64 rows = ((input->xcount - size)/hop + 1)/average;
+    check(rows >= 1, "not enough samples to average %lld FFTs", average);
+    const bool cplx = mode == "cf";
+    const int64 width = cplx ? 2*size : size;
+    const double rate = 1/input->xdelta;
+
+    // scaled so white noise has the same power per bin as per sample
+    vector<float> taper(size);
+    double power = 0;
+    for (int64 ii = 0; ii<size; ii++) {
+        taper[ii] = firwin(window, ii - size/2, size);
+        power += taper[ii]*taper[ii];
+    }
+
+    bluewriter output(outpath);
+    output->type   = 2000;
+    output->format = cplx ? "CF" : "SF";
+    output->time   = input->time;
+    output->xstart = -(size/2)*rate/size;
+    output->xdelta = rate/size;
+    output->xcount = size;
+    output->xunits = blueunits::freq;
+    // each row is at the center of the samples that went into it
+    output->ystart = input->xstart + .5*((average - 1)*hop + size - 1)*input->xdelta;
+    output->ydelta = input->xdelta*hop*average;
+    output->ycount = rows;
+    output->yunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    // Frames are a few MB of input or output, whichever is bigger, with
+    // at least one row for every thread
+    pipeline pipe;
+    pipe.input   = &input;
+    pipe.output  = &output;
+    pipe.hop     = hop;
+    pipe.size    = size;
+    pipe.average = average;
+    pipe.rows    = rows;
+    pipe.width   = width;
+    pipe.block   = max(threads, 1048576/max(width, average*hop));
+
+    const int64 frames = 4;
+    list<frame*> storage;
+    for (int64 ii = 0; ii<frames; ii++) {
+        frame* fr = new frame();
+        fr->input.resize((pipe.block*average - 1)*hop + size);
+        fr->output.resize(pipe.block*width);
+        storage.append(fr);
+        pipe.empty.push(fr);
+    }
+
+    kissfft<float> plan(size);
+    threadpool pool(threads);
+    spectra work;
+    work.plan     = &plan;
+    work.window   = taper.data();
+    work.size     = size;
+    work.hop      = hop;
+    work.average  = average;
+    work.cplx     = cplx;
+    work.decibels = mode == "db";
+    work.scale    = 1/sqrt(power);
+    work.each     = 3*size + plan.scratch_size();
+    vector<cfloat> scratch(threads*work.each);
+    work.scratch  = scratch.data();
+
+    pthread_t readthread, writethread;
+    check(pthread_create(&readthread, 0, reader, &pipe) == 0, "starting reader thread");
+    check(pthread_create(&writethread, 0, writer, &pipe) == 0, "starting writer thread");
+
+    for (;;) {
+        frame* fr = pipe.full.pull();
+        if (fr == 0) break;
+        work.fr = fr;
+        work.share = (fr->rows + threads - 1)/threads;
+        pool.parfor(threads, work);
+
+        // center the rows so the columns go from -fs/2 up
+        if (cplx) {
+            hshift((cfloat*)fr->output.data(), fr->rows, size, (size + 1)/2);
+        } else {
+            hshift(fr->output.data(), fr->rows, size, (size + 1)/2);
+        }
+        pipe.done.push(fr);
+    }
+    pipe.done.push(0);
+
+    pthread_join(readthread, 0);
+    pthread_join(writethread, 0);
+    for (int64 ii = 0; ii<frames; ii++) {
+        delete storage[ii];
+    }
+
+    return 0;
+}
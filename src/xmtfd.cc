@@ -0,0 +1,62 @@
+#include "xmtools.h"
+using namespace xm;
+
+int main(int argc, char* argv[]) {
+
+    cmdline args(
+        argc, argv, "tune, filter, and decimate\n"
+        "moves freq to baseband, lowpass filters, and keeps every decim'th sample"
+    );
+    double freq     = args.getdouble("freq", 0, "frequency to move to baseband (Hz)");
+    int64 decim     = args.getint64("decim", "decimation factor");
+    double percent  = args.getdouble("percent", 80, "percentage of output bandwidth to preserve");
+    int64 window    = args.getint64("firwin", 2, "FIR window for the lowpass");
+    bool copykwds   = args.getswitch("copykwds", "copy the input keywords to the output file");
+    string inpath   = args.getinput("input.tmp", "input blue file");
+    string outpath  = args.getoutput("output.tmp", "output blue file");
+    args.done();
+
+    check(decim >= 1, "need positive decimation");
+    check(percent > 0 && percent <= 100, "percent must be in (0, 100]");
+
+    bluereader input(inpath);
+    check(input->type/1000 == 1, "must be Type 1000 file");
+
+    const double inrate = 1/input->xdelta;
+    double dwidth = percent * .01 / decim;
+    int64 taps = (int64)ceil(8 * apodize(window) / dwidth);
+    tfd engine(-freq/inrate, decim, window, dwidth, taps);
+
+    const int64 samples = (input->xcount + decim - 1)/decim;
+
+    bluewriter output(outpath);
+    output->time   = input->time;
+    output->xstart = input->xstart;
+    output->xdelta = input->xdelta*decim;
+    output->xcount = samples;
+    output->xunits = input->xunits;
+
+    if (copykwds) {
+        check(input.kwds_ready(), "keywords must be ready");
+        output->kwds = input->kwds;
+    }
+
+    // Size the blocks so the input for each stays around a few MB
+    const int64 block = max(1, min(16384, 262144/decim));
+    vector<cfloat> data(block);
+    vector<cfloat> grab(engine.needed(block));
+
+    int64 offset = 0;
+    while (offset < samples) {
+        int64 amount = min(block, samples - offset);
+
+        input.grabcf(offset*decim - engine.margin(), grab.data(), engine.needed(amount));
+        engine.apply(data.data(), offset, amount, grab.data());
+        output.write(data.data(), amount*sizeof(cfloat));
+
+        offset += amount;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,67 @@
+#include <xm/baseband.h>
+#include <xm/blocktuner.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace xm;
+
+//
+// The chain baseband replaces: tune by -fs/4, then the streaming halfband
+// filter and decimate by 2.  Both treat the input as zero outside of the
+// samples given, so every output should match, edges included.  The
+// baseband outputs are computed a piece at a time at their offsets.
+//
+template<class type>
+static void chaincheck(int window, double percent, int64 length, int64 piece, double scale) {
+    vector<type> raw(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        // a couple of tones and some noise
+        double val = (
+            .5*cos(.0731*ii) + .3*sin(1.234*ii + 1) +
+            .2*(rand()/(double)RAND_MAX - .5)
+        );
+        raw[ii] = (type)(scale*val);
+    }
+
+    vector<cfloat> tuned(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        tuned[ii] = cfloat(raw[ii], 0);
+    }
+    blocktuner tuner(-.25);
+    tuner.apply(tuned.data(), 0, length);
+    halfband filter(window, .5 - percent*.005);
+    const int64 outputs = (length + 1)/2;
+    vector<cfloat> want(outputs + filter.muls() + 1);
+    int64 got = filter.apply(want.data(), tuned.data(), length);
+    got += filter.flush(want.data() + got);
+    check(got == outputs, "halfband gave %lld outputs", got);
+
+    baseband engine(window, percent);
+    const int64 margin = engine.margin();
+    vector<type> padded(length + 2*margin + 2, (type)0);
+    for (int64 ii = 0; ii<length; ii++) {
+        padded[margin + ii] = raw[ii];
+    }
+    vector<cfloat> dst(outputs);
+    for (int64 off = 0; off<outputs; off += piece) {
+        const int64 amt = min(piece, outputs - off);
+        check(2*off + engine.needed(amt) <= padded.size(), "needed");
+        engine.apply(dst.data() + off, off, amt, padded.data() + 2*off);
+    }
+
+    double error = 0, power = 0;
+    for (int64 mm = 0; mm<outputs; mm++) {
+        error += mag2(cdouble(dst[mm].re - want[mm].re, dst[mm].im - want[mm].im));
+        power += mag2(cdouble(want[mm].re, want[mm].im));
+    }
+    check(error <= 1e-10*power, "length %lld piece %lld error %g", length, piece, sqrt(error/power));
+}
+
+int main() {
+    chaincheck<float>(2, 80, 1001, 1001, 1);
+    chaincheck<float>(2, 80, 1000, 7, 1);
+    chaincheck<float>(1, 95, 4097, 333, 1);
+    chaincheck<int16_t>(3, 60, 777, 13, 10000);
+    chaincheck<int16_t>(2, 90, 20001, 4096, 20000);
+    return 0;
+}
@@ -1,7 +1,69 @@
 #include <xm/blocktuner.h>
+#include <xm/vector.h>
+#include <stdlib.h>
+#include <stdint.h>
 
-int main() {
-    xm::blocktuner bt(0.25);
+using namespace xm;
+
+//
+// Both apply methods against exp(j*phase) computed one sample at a time.
+// The data is tuned in uneven pieces at their offsets, so the phase has to
+// carry across calls and across the 1024 sample blocks inside each call.
+// The reference uses long double so a large off still has a clean phase.
+//
+template<class type>
+static void tunecheck(
+    double dfreq, double phase0, int64 off,
+    int64 length, int64 piece, double scale
+) {
+    vector<complex<type> > src(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        src[ii] = complex<type>(
+            (type)(scale*(rand()/(double)RAND_MAX - .5)),
+            (type)(scale*(rand()/(double)RAND_MAX - .5))
+        );
+    }
+
+    vector<cdouble> want(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        long double cycles = fmodl((long double)dfreq*(off + ii), 1.0L);
+        double angle = 2*M_PI*(phase0 + (double)cycles);
+        double cc = cos(angle), ss = sin(angle);
+        double re = src[ii].re, im = src[ii].im;
+        want[ii] = cdouble(re*cc - im*ss, im*cc + re*ss);
+    }
+
+    blocktuner tuner(dfreq, phase0);
+    vector<cfloat> simd(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        simd[ii] = cfloat(src[ii].re, src[ii].im);
+    }
+    vector<cfloat> fused(length);
+    for (int64 pos = 0; pos<length; pos += piece) {
+        const int64 amt = min(piece, length - pos);
+        tuner.apply(simd.data() + pos, off + pos, amt);
+        tuner.apply(fused.data() + pos, src.data() + pos, off + pos, amt);
+    }
 
+    double simderr = 0, fusederr = 0;
+    for (int64 ii = 0; ii<length; ii++) {
+        simderr = max(simderr, mag2(cdouble(simd[ii].re - want[ii].re, simd[ii].im - want[ii].im)));
+        fusederr = max(fusederr, mag2(cdouble(fused[ii].re - want[ii].re, fused[ii].im - want[ii].im)));
+    }
+    // a few float roundings of numbers up to scale
+    const double limit = 1e-5*scale;
+    check(sqrt(simderr) <= limit, "simd dfreq %g off %lld piece %lld error %g", dfreq, off, piece, sqrt(simderr));
+    check(sqrt(fusederr) <= limit, "fused dfreq %g off %lld piece %lld error %g", dfreq, off, piece, sqrt(fusederr));
+}
+
+int main() {
+    tunecheck<float>(0.25, 0, 0, 1024, 1024, 1);
+    tunecheck<float>(-.1234567, .3, 0, 5003, 5003, 1);
+    tunecheck<float>(.0314159, 0, 17, 4099, 7, 1);
+    tunecheck<float>(.4321, -.125, 1001, 3001, 1023, 1);
+    tunecheck<float>(-.0078125, .5, 1000000000003LL, 2500, 333, 1);
+    tunecheck<int16_t>(.2718, 0, 3, 2051, 13, 20000);
+    tunecheck<int16_t>(-.3, .1, 999, 4097, 1025, 30000);
+    tunecheck<int16_t>(.0009765625, 0, 123456789012LL, 1500, 1, 10000);
     return 0;
 }
@@ -0,0 +1,73 @@
+#include <xm/caf.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// A reference hidden in the input at a known lag and Doppler, with the
+// surface around it checked against the defining sum in double
+static void directcheck(int64 n1, int64 n2, int64 delay, int64 shift, int64 oversample, threadpool& pool) {
+    vector<cfloat> s1(n1), s2(n2);
+    for (int64 ii = 0; ii<n1; ii++) {
+        s1[ii] = cfloat(rand()/(double)RAND_MAX - .5, rand()/(double)RAND_MAX - .5);
+    }
+    for (int64 ii = 0; ii<n2; ii++) {
+        s2[ii] = cfloat(.01*(rand()/(double)RAND_MAX - .5), .01*(rand()/(double)RAND_MAX - .5));
+    }
+
+    // the Doppler step depends on the FFT size the engine picks
+    int64 fftsize = 1;
+    while (fftsize < n1 + n2 - 1) fftsize *= 2;
+    const double step = 1.0/(fftsize*oversample);
+    for (int64 nn = 0; nn<n1; nn++) {
+        const double phase = 2*M_PI*step*shift*(nn + delay);
+        s2[nn + delay] += s1[nn]*cfloat(cos(phase), sin(phase));
+    }
+    caf search(s1.data(), n1, s2.data(), n2, oversample, pool);
+    check(search.fftsize() == fftsize, "FFT size %lld", search.fftsize());
+
+    const int64 doppler = shift - 5, rows = 11;
+    const int64 lag = -n1 - 3, cols = n1 + n2 + 6;
+    vector<float> surface(rows*cols);
+    search.surface(surface.data(), doppler, rows, lag, cols, pool);
+
+    double norm1 = 0, norm2 = 0;
+    for (int64 ii = 0; ii<n1; ii++) norm1 += mag2(cdouble(s1[ii].re, s1[ii].im));
+    for (int64 ii = 0; ii<n2; ii++) norm2 += mag2(cdouble(s2[ii].re, s2[ii].im));
+
+    double error = 0, best = 0;
+    int64 bestrow = -1, bestcol = -1;
+    for (int64 rr = 0; rr<rows; rr++) {
+        const double dfreq = (doppler + rr)*step;
+        for (int64 cc = 0; cc<cols; cc++) {
+            const int64 tau = lag + cc;
+            cdouble acc(0, 0);
+            for (int64 nn = max((int64)0, -tau); nn<n1 && nn + tau<n2; nn++) {
+                const double phase = -2*M_PI*dfreq*(nn + tau);
+                acc += (
+                    conj(cdouble(s1[nn].re, s1[nn].im))*
+                    cdouble(s2[nn + tau].re, s2[nn + tau].im)*
+                    cdouble(cos(phase), sin(phase))
+                );
+            }
+            const double want = sqrt(mag2(acc)/(norm1*norm2));
+            const double got = surface[rr*cols + cc];
+            error = max(error, fabs(got - want));
+            if (got > best) {
+                best = got;
+                bestrow = rr;
+                bestcol = cc;
+            }
+        }
+    }
+    check(error < 1e-5, "surface error %g", error);
+    check(doppler + bestrow == shift && lag + bestcol == delay, "peak at %lld, %lld", doppler + bestrow, lag + bestcol);
+    check(best > .99, "peak %g", best);
+}
+
+int main() {
+    threadpool pool(2);
+    directcheck(100, 300, 37, 7, 3, pool);
+    directcheck(64, 64, 0, -4, 1, pool);
+    directcheck(33, 200, 150, 0, 4, pool);
+    return 0;
+}
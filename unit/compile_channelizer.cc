@@ -0,0 +1,47 @@
+#include <xm/channelizer.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// A tone at the center of channel k is DC after tuning by -k/channels, so
+// that channel comes out as 1 + 0j in every row.  The neighbors only get
+// what leaks through the prototype lowpass.
+static void tonecheck(
+    int64 channels, int64 decim, int window, int64 branch, int64 which,
+    int64 off, int64 len, double neighbor, double rest
+) {
+    channelizer engine(channels, decim, window, 1.0/channels, branch);
+    const int64 first = off*decim - engine.margin();
+    vector<cfloat> src(engine.needed(len)), dst(len*channels);
+    for (int64 ii = 0; ii<src.size(); ii++) {
+        const double phase = 2*M_PI*(double)(((first + ii)*which)%channels)/channels;
+        src[ii] = cfloat(cos(phase), sin(phase));
+    }
+    engine.apply(dst.data(), off, len, src.data());
+
+    double center = 0, near = 0, far = 0;
+    for (int64 mm = 0; mm<len; mm++) {
+        const cfloat* row = dst.data() + mm*channels;
+        center = max(center, (double)mag(row[which] - cfloat(1, 0)));
+        for (int64 kk = 0; kk<channels; kk++) {
+            if (kk == which) continue;
+            const int64 apart = min((kk - which + channels)%channels, (which - kk + channels)%channels);
+            const double power = mag2(row[kk]);
+            if (apart == 1) near = max(near, power);
+            else far = max(far, power);
+        }
+    }
+    check(center < 1e-4, "channel %lld of %lld is off by %g", which, channels, center);
+    check(10*log10(near + 1e-300) < neighbor, "neighbors of %lld at %.1f dB", which, 10*log10(near));
+    check(10*log10(far + 1e-300) < rest, "other channels of %lld at %.1f dB", which, 10*log10(far));
+}
+
+int main() {
+    // critically sampled, 2x oversampled, and a channel count that isn't
+    // a power of two, with rows far enough in that the phase matters
+    tonecheck(16, 16, 2, 8, 5, 100, 40, -70, -90);
+    tonecheck(16, 8, 2, 8, 13, 12345, 40, -70, -90);
+    tonecheck(64, 32, 3, 12, 0, 0, 20, -110, -120);
+    tonecheck(10, 5, 1, 16, 7, 999, 30, -70, -90);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <xm/chirptuner.h>
+#include <xm/vector.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// The phase in cycles at a sample, from the piecewise closed form in long
+// double, with each segment starting where the one before left off
+static long double cycles(const list<chirpsegment>& profile, double phase0, int64 sample) {
+    long double phase = phase0;
+    int64 ii = 0;
+    for (; ii + 1<profile.size() && profile[ii + 1].start <= sample; ii++) {
+        const long double nn = profile[ii + 1].start - profile[ii].start;
+        phase += profile[ii].dfreq*nn + profile[ii].drate*nn*(nn - 1)/2;
+        phase -= floorl(phase);
+    }
+    const long double nn = sample - profile[ii].start;
+    phase += profile[ii].dfreq*nn + profile[ii].drate*nn*(nn - 1)/2;
+    return phase - floorl(phase);
+}
+
+// Tunes ones a piece at a time and compares against exp(j*2*pi*phase),
+// along with the exact phase and frequency
+static void compare(
+    const list<chirpsegment>& profile, double phase0,
+    int64 first, int64 length, const int64* pieces, int64 npieces
+) {
+    chirptuner tuner(profile, phase0);
+    vector<cfloat> data(length, cfloat(1, 0));
+    int64 off = 0;
+    for (int64 ii = 0; off<length; ii++) {
+        const int64 amt = min(pieces[ii%npieces], length - off);
+        tuner.apply(data.data() + off, first + off, amt);
+        off += amt;
+    }
+
+    for (int64 ii = 0; ii<length; ii++) {
+        const int64 sample = first + ii;
+        const long double want = cycles(profile, phase0, sample);
+        const double angle = 2*M_PI*(double)want;
+        const cfloat got = data[ii];
+        const double error = mag(cdouble(got.re - cos(angle), got.im - sin(angle)));
+        check(error < 2e-5, "sample %lld: (%f, %f) vs angle %f", sample, got.re, got.im, angle);
+
+        // the rate is rounded to 2**-64, which grows with the square of
+        // the sample, to about 1e-10 cycles this far in
+        long double exact = tuner.phase(sample)*powl(2.0, -64);
+        long double diff = exact - want;
+        diff -= floorl(diff + .5);
+        check(fabsl(diff) < 1e-9, "phase at sample %lld", sample);
+    }
+}
+
+int main() {
+    const int64 odd[] = { 777, 1, 1500, 3 };
+    const int64 whole[] = { 1000000 };
+
+    // a constant chirp from well into the stream
+    list<chirpsegment> single;
+    chirpsegment one = { 0, .1234567, 3.21e-6 };
+    single.append(one);
+    compare(single, .3, 123456, 10000, odd, 4);
+    compare(single, .3, 0, 5000, whole, 1);
+
+    // a negative rate through zero frequency
+    list<chirpsegment> down;
+    chirpsegment two = { 0, .01, -7.5e-6 };
+    down.append(two);
+    compare(down, 0, 0, 4000, odd, 4);
+
+    // a piecewise profile, with the first segment also covering the
+    // samples before it, and calls that straddle segment starts at odd
+    // offsets and the 1024 sample chunks
+    list<chirpsegment> pieces;
+    chirpsegment aa = { 50, .1, 1e-5 };
+    chirpsegment bb = { 3001, .13, -2e-5 };
+    chirpsegment cc = { 5000, -.3, 0 };
+    chirpsegment dd = { 5001, .25, 4e-7 };
+    pieces.append(aa);
+    pieces.append(bb);
+    pieces.append(cc);
+    pieces.append(dd);
+    const int64 straddle[] = { 37, 2953, 1999, 5, 3000 };
+    compare(pieces, .7, 0, 12000, straddle, 5);
+    compare(pieces, .7, 2990, 37, whole, 1);
+    compare(pieces, .7, 4999, 3, whole, 1);
+
+    // the frequency carries across a segment with a rate
+    chirptuner tuner(pieces, .7);
+    const uint64_t rate = tuner.freq(51) - tuner.freq(50);
+    check(tuner.freq(3000) == tuner.freq(50) + 2950*rate, "frequency along the first segment");
+
+    return 0;
+}
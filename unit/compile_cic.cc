@@ -0,0 +1,44 @@
+#include <xm/cic.h>
+
+int main() {
+    using namespace xm;
+
+    // three lanes covers both the paired and single lane loops, and the
+    // large values make the integrators wrap around
+    const int64 stages = 3, ratio = 5, lanes = 3, frames = 1000;
+    int32_t input[frames*lanes];
+    for (int64 ii = 0; ii<frames*lanes; ii++) {
+        input[ii] = (int32_t)((ii*2654435761LL)%2000000001 - 1000000000);
+    }
+
+    cic engine(stages, ratio, lanes, 32);
+    int64 output[(frames/ratio + 1)*lanes];
+    int64 count = 0;
+    for (int64 ii = 0; ii<frames; ii += 7) {
+        int64 amt = min(7, frames - ii);
+        count += engine.apply(output + count*lanes, input + ii*lanes, amt);
+    }
+    check(count == frames/ratio, "output count");
+
+    // compare to direct boxcar sums
+    for (int64 ll = 0; ll<lanes; ll++) {
+        int64 boxed[frames];
+        for (int64 ii = 0; ii<frames; ii++) {
+            boxed[ii] = input[ii*lanes + ll];
+        }
+        for (int64 ss = 0; ss<stages; ss++) {
+            for (int64 ii = frames - 1; ii>=0; ii--) {
+                int64 sum = 0;
+                for (int64 kk = 0; kk<ratio && kk<=ii; kk++) {
+                    sum += boxed[ii - kk];
+                }
+                boxed[ii] = sum;
+            }
+        }
+        for (int64 mm = 0; mm<count; mm++) {
+            check(output[mm*lanes + ll] == boxed[(mm + 1)*ratio - 1], "exact");
+        }
+    }
+
+    return 0;
+}
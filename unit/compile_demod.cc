@@ -0,0 +1,78 @@
+#include <xm/demod.h>
+#include <xm/vector.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// every mode and accuracy against doubles, with the input given a piece at
+// a time so the carried state gets used
+static void compare(demod::kind mode, int accuracy, double tolerance, int64 length, int64 piece) {
+    vector<cfloat> xx(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        xx[ii] = cfloat(rand()/(double)RAND_MAX - .5, rand()/(double)RAND_MAX - .5);
+    }
+    // zero only for AM, since the angle of zero depends on its signs
+    if (mode == demod::am) xx[0] = cfloat(0, 0);
+    xx[length/2] = cfloat(-1, 0);
+
+    demod engine(mode, accuracy);
+    vector<float> yy(length);
+    for (int64 off = 0; off<length; off += piece) {
+        engine.apply(yy.data() + off, xx.data() + off, min(piece, length - off));
+    }
+
+    double phase = atan2(xx[0].im, xx[0].re);
+    for (int64 ii = 0; ii<length; ii++) {
+        const cdouble cur(xx[ii].re, xx[ii].im);
+        const cdouble prev = ii ? cdouble(xx[ii - 1].re, xx[ii - 1].im) : cur;
+        const cdouble diff = cur*conj(prev);
+        double want = 0, error = 0;
+        switch (mode) {
+            case demod::am: want = sqrt(mag2(cur)); break;
+            case demod::pm: want = atan2(cur.im, cur.re); break;
+            case demod::fm: want = atan2(diff.im, diff.re); break;
+            case demod::unwrapped: want = phase += atan2(diff.im, diff.re); break;
+        }
+        error = fabs(yy[ii] - want);
+        if (mode == demod::am) error /= max(want, 1e-30);
+        // the angle at -1 can come out as -pi
+        if (mode == demod::pm && fabs(want) > 3) error = fabs(fabs(yy[ii]) - fabs(want));
+        check(error <= tolerance, "mode %d accuracy %d sample %lld: %lf vs %lf", mode, accuracy, ii, yy[ii], want);
+    }
+}
+
+// a long steady tone, where summing the FM differences would drift
+static void longtone(int accuracy, double tolerance) {
+    const int64 length = 1000000;
+    const double freq = .1237;
+    vector<cfloat> xx(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        const double angle = 2*M_PI*freq*ii + 1;
+        xx[ii] = cfloat(cos(angle), sin(angle));
+    }
+
+    demod engine(demod::unwrapped, accuracy);
+    vector<float> yy(length);
+    for (int64 off = 0; off<length; off += 65536) {
+        engine.apply(yy.data() + off, xx.data() + off, min((int64)65536, length - off));
+    }
+
+    for (int64 ii = 0; ii<length; ii += 997) {
+        const double want = 2*M_PI*freq*ii + 1;
+        // the output is float, so allow for its rounding too
+        const double error = fabs(yy[ii] - want);
+        check(error <= tolerance + want*1.2e-7, "accuracy %d sample %lld: %lf vs %lf", accuracy, ii, yy[ii], want);
+    }
+}
+
+int main() {
+    const double tolerance[] = { 1e-6, 1e-3, 2e-5, 5e-7 };
+    for (int accuracy = 0; accuracy<=3; accuracy++) {
+        compare(demod::am, accuracy, accuracy == 1 ? 2e-3 : accuracy == 2 ? 6e-6 : 5e-7, 1001, 77);
+        compare(demod::pm, accuracy, tolerance[accuracy], 1001, 1000);
+        compare(demod::fm, accuracy, tolerance[accuracy], 1001, 3);
+        compare(demod::unwrapped, accuracy, 1e3*tolerance[accuracy], 1001, 64);
+        longtone(accuracy, tolerance[accuracy]);
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include <xm/fastconv.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// both methods against y[m] = sum over k of h[k]*x[m*decim + (taps - 1)/2 - k],
+// with the input given a piece at a time
+static void compare(int64 taps, int64 decim, int64 fftsize, bool real, int64 length, int64 piece) {
+    vector<cfloat> hh(taps), xx(length);
+    for (int64 kk = 0; kk<taps; kk++) {
+        hh[kk] = cfloat(rand()/(double)RAND_MAX - .5, real ? 0 : rand()/(double)RAND_MAX - .5);
+    }
+    for (int64 ii = 0; ii<length; ii++) {
+        xx[ii] = cfloat(rand()/(double)RAND_MAX - .5, rand()/(double)RAND_MAX - .5);
+    }
+
+    fastconv engine(hh, decim, fftsize);
+    vector<cfloat> yy(engine.capacity(length) + engine.capacity(0));
+    int64 got = 0;
+    for (int64 off = 0; off<length; off += piece) {
+        got += engine.apply(yy.data() + got, xx.data() + off, min(piece, length - off));
+    }
+    got += engine.flush(yy.data() + got);
+    check(got == (length + decim - 1)/decim, "output count %lld", got);
+
+    double error = 0, power = 0;
+    for (int64 mm = 0; mm<got; mm++) {
+        cdouble acc(0, 0);
+        for (int64 kk = 0; kk<taps; kk++) {
+            int64 jj = mm*decim + (taps - 1)/2 - kk;
+            if (jj < 0 || jj >= length) continue;
+            acc += cdouble(hh[kk].re, hh[kk].im)*cdouble(xx[jj].re, xx[jj].im);
+        }
+        error += mag2(acc - cdouble(yy[mm].re, yy[mm].im));
+        power += mag2(acc);
+    }
+    check(error <= 1e-11*power, "taps %lld decim %lld fftsize %lld", taps, decim, fftsize);
+}
+
+int main() {
+    compare(1, 1, 0, true, 1000, 77);
+    compare(31, 3, 1, false, 10000, 1000);
+    compare(31, 3, 64, false, 10000, 999);
+    compare(1001, 1, 0, true, 50000, 4096);
+    compare(1001, 7, 0, false, 50000, 20000);
+    compare(4000, 1, 8192, false, 30000, 3);
+    compare(5, 10, 0, true, 3, 1);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <xm/firparks.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// The weighted error from a direct sum of the taps, at a few thousand
+// frequencies across each band
+static double measure(
+    const double* taps, int64 count, int64 bands, const double* edges,
+    const double* gains, const double* weights
+) {
+    double worst = 0;
+    for (int64 bb = 0; bb<bands; bb++) {
+        const double lo = edges[2*bb], hi = edges[2*bb + 1];
+        for (int64 ii = 0; ii <= 4000; ii++) {
+            const double ff = lo + (hi - lo)*ii/4000;
+            double sum = 0;
+            for (int64 kk = 0; kk<count; kk++) {
+                sum += taps[kk]*cos(M_PI*ff*(kk - (count - 1)/2.0));
+            }
+            const double want = gains[2*bb] + (gains[2*bb + 1] - gains[2*bb])*(ff - lo)/(hi - lo);
+            worst = max(worst, weights[bb]*fabs(want - sum));
+        }
+    }
+    return worst;
+}
+
+static void design(
+    int64 count, int64 bands, const double* edges, const double* gains,
+    const double* weights, threadpool& pool
+) {
+    vector<double> taps(count);
+    const double ripple = firparks(taps.data(), count, bands, edges, gains, weights, pool);
+    check(ripple > 0 && ripple < .1, "ripple %lg for %lld taps", ripple, count);
+    for (int64 kk = 0; kk<count; kk++) {
+        check(taps[kk] == taps[count - 1 - kk], "symmetric taps");
+    }
+
+    // between grid points the error can peak a little higher, most of
+    // all in the narrow ripples next to the band edges
+    const double actual = measure(taps.data(), count, bands, edges, gains, weights);
+    check(
+        actual >= ripple*(1 - 1e-6) && actual < ripple*1.05,
+        "measured %lg vs %lg for %lld taps", actual, ripple, count
+    );
+}
+
+// Designs whose ripple would be below double precision have to say so
+static void toosmall(
+    int64 count, int64 bands, const double* edges, const double* gains,
+    const double* weights, threadpool& pool
+) {
+    vector<double> taps(count);
+    bool failed = false;
+    try {
+        firparks(taps.data(), count, bands, edges, gains, weights, pool);
+    } catch (const std::exception&) {
+        failed = true;
+    }
+    check(failed, "%lld taps should have failed", count);
+}
+
+int main() {
+    threadpool pool(2);
+
+    const double lowedges[] = { 0, .4, .5, 1 };
+    const double lowgains[] = { 1, 1, 0, 0 };
+    const double lowweights[] = { 1, 10 };
+    design(33, 2, lowedges, lowgains, lowweights, pool);
+    design(34, 2, lowedges, lowgains, lowweights, pool);
+    design(120, 2, lowedges, lowgains, lowweights, pool);
+
+    // more than 64 terms start from a design with half the taps
+    const double sharpedges[] = { 0, .4, .42, 1 };
+    design(401, 2, sharpedges, lowgains, lowweights, pool);
+    design(400, 2, sharpedges, lowgains, lowweights, pool);
+
+    // a bandpass with sloped gain across the pass band
+    const double multiedges[] = { 0, .2, .25, .5, .55, 1 };
+    const double multigains[] = { 0, 0, 1, .5, 0, 0 };
+    const double multiweights[] = { 10, 1, 10 };
+    design(75, 3, multiedges, multigains, multiweights, pool);
+    design(250, 3, multiedges, multigains, multiweights, pool);
+
+    // wide transitions with too many taps
+    const double wideedges[] = { 0, .3, .7, 1 };
+    const double widegains[] = { 1, 1, 0, 0 };
+    const double wideweights[] = { 1, 1 };
+    toosmall(80, 2, wideedges, widegains, wideweights, pool);
+    toosmall(340, 2, lowedges, lowgains, lowweights, pool);
+    toosmall(1000, 3, multiedges, multigains, multiweights, pool);
+
+    // a halfband has zeros at even offsets from the middle
+    const double edges[] = { 0, .45, .55, 1 };
+    const double gains[] = { 1, 1, 0, 0 };
+    const double weights[] = { 1, 1 };
+    vector<double> taps(43);
+    firparks(taps.data(), 43, 2, edges, gains, weights, pool);
+    for (int64 kk = 2; kk <= 20; kk += 2) {
+        check(fabs(taps[21 + kk]) < 1e-9, "halfband tap %lld is %lg", kk, taps[21 + kk]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <xm/halfband.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// A passband tone through apply and flush, given a piece at a time, should
+// come out as every other input once the filter is past the ends
+template<class filter>
+static void tone(filter& engine, int64 decim, int64 muls, int64 length, int64 piece) {
+    const double freq = .05/decim;
+    vector<cfloat> xx(length);
+    for (int64 ii = 0; ii<length; ii++) {
+        xx[ii] = cfloat(cos(2*M_PI*freq*ii), sin(2*M_PI*freq*ii));
+    }
+
+    const int64 expect = (length + decim - 1)/decim;
+    vector<cfloat> yy(expect + muls + 64);
+    int64 got = 0;
+    for (int64 off = 0; off<length; off += piece) {
+        got += engine.apply(yy.data() + got, xx.data() + off, min(piece, length - off));
+    }
+    got += engine.flush(yy.data() + got);
+    check(got == expect, "output count %lld, not %lld", got, expect);
+
+    const int64 edge = 2*muls/decim + 1;
+    double error = 0;
+    for (int64 mm = edge; mm<got - edge; mm++) {
+        error = max(error, (double)mag(yy[mm] - xx[mm*decim]));
+    }
+    check(error < 1e-3, "passband error %lg", error);
+}
+
+int main() {
+    halfband small(2, .2);
+    tone(small, 2, small.muls(), 10001, 999);
+
+    // spans well past the 4096 sample chunk
+    halfband large(2, .0002);
+    check(large.muls() > 4096, "large span");
+    tone(large, 2, large.muls(), 50000, 3000);
+    halfband uneven(2, .0002);
+    tone(uneven, 2, uneven.muls(), 9999, 1);
+
+    halfcascade single(2, 99.9, 1);
+    tone(single, 2, large.muls(), 30001, 16384);
+    halfcascade triple(2, 95, 3);
+    tone(triple, 8, large.muls(), 100000, 7777);
+
+    return 0;
+}
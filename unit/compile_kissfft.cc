@@ -0,0 +1,152 @@
+#include <xm/kissfft.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// compares the SIMD path to the recursive one, and powers of 2 in place
+template<class type>
+static void compare(int64 size, bool inverse, double tolerance) {
+    kissfft<type> fft(size, inverse);
+    vector<complex<type> > src(size), fast(size), slow(size);
+    for (int64 ii = 0; ii<size; ii++) {
+        src[ii].re = (type)(rand()/(double)RAND_MAX - .5);
+        src[ii].im = (type)(rand()/(double)RAND_MAX - .5);
+    }
+    fft.exec_generic(slow.data(), src.data());
+    fft.exec(fast.data(), src.data());
+
+    double error = 0, power = 0;
+    for (int64 ii = 0; ii<size; ii++) {
+        error += mag2(fast[ii] - slow[ii]);
+        power += mag2(slow[ii]);
+    }
+    check(error <= tolerance*tolerance*power, "size %lld error %g", size, sqrt(error/power));
+
+    if (size & (size - 1)) return;
+    fft.exec(src.data(), src.data());
+    for (int64 ii = 0; ii<size; ii++) {
+        check(src[ii].re == fast[ii].re && src[ii].im == fast[ii].im, "in place %lld", size);
+    }
+}
+
+// sizes with large prime factors against a direct DFT
+template<class type>
+static void primecheck(int64 size, bool inverse, double tolerance) {
+    kissfft<type> fft(size, inverse);
+    vector<complex<type> > src(size), dst(size);
+    for (int64 ii = 0; ii<size; ii++) {
+        src[ii].re = (type)(rand()/(double)RAND_MAX - .5);
+        src[ii].im = (type)(rand()/(double)RAND_MAX - .5);
+    }
+    fft.exec(dst.data(), src.data());
+
+    double error = 0, power = 0;
+    for (int64 kk = 0; kk<size; kk++) {
+        cdouble acc(0, 0);
+        for (int64 nn = 0; nn<size; nn++) {
+            double phase = (inverse ? 2 : -2)*M_PI*((nn*kk)%size)/size;
+            acc += cdouble(src[nn].re, src[nn].im)*cdouble(cos(phase), sin(phase));
+        }
+        error += mag2(cdouble(dst[kk].re, dst[kk].im) - acc);
+        power += mag2(acc);
+    }
+    check(error <= tolerance*tolerance*power, "prime size %lld error %g", size, sqrt(error/power));
+}
+
+// strided batches over threads against one at a time
+template<class type>
+static void batchcheck(int64 size, int64 count, threadpool& pool) {
+    kissfft<type> fft(size);
+    // transform k is column k of a count by size matrix
+    vector<complex<type> > src(size*count), dst(size*count), col(size), one(size);
+    for (int64 ii = 0; ii<size*count; ii++) {
+        src[ii].re = (type)(rand()/(double)RAND_MAX - .5);
+        src[ii].im = (type)(rand()/(double)RAND_MAX - .5);
+    }
+    fft.batch(dst.data(), src.data(), count, count, 1, pool);
+    for (int64 kk = 0; kk<count; kk++) {
+        for (int64 ii = 0; ii<size; ii++) col[ii] = src[ii*count + kk];
+        fft.exec(one.data(), col.data());
+        for (int64 ii = 0; ii<size; ii++) {
+            check(
+                one[ii].re == dst[ii*count + kk].re && one[ii].im == dst[ii*count + kk].im,
+                "batch %lld transform %lld", size, kk
+            );
+        }
+    }
+
+    // and rows, in place
+    vector<complex<type> > rows(src);
+    fft.batch(rows.data(), rows.data(), count, 1, size, pool);
+    for (int64 kk = 0; kk<count; kk++) {
+        fft.exec(one.data(), src.data() + kk*size);
+        for (int64 ii = 0; ii<size; ii++) {
+            check(
+                one[ii].re == rows[kk*size + ii].re && one[ii].im == rows[kk*size + ii].im,
+                "in place batch %lld transform %lld", size, kk
+            );
+        }
+    }
+}
+
+// the real transforms against the complex one, and back
+template<class type>
+static void realcheck(int64 size, double tolerance) {
+    kissfft<type> fft(size);
+    realfft<type> fwd(size), inv(size, true);
+    vector<type> src(size), back(size);
+    vector<complex<type> > full(size), cplx(size), half(size/2 + 1);
+    for (int64 ii = 0; ii<size; ii++) {
+        src[ii] = (type)(rand()/(double)RAND_MAX - .5);
+        cplx[ii] = complex<type>(src[ii], 0);
+    }
+    fft.exec(full.data(), cplx.data());
+    fwd.exec(half.data(), src.data());
+    inv.exec(back.data(), half.data());
+
+    double error = 0, power = 0;
+    for (int64 kk = 0; kk<=size/2; kk++) {
+        error += mag2(half[kk] - full[kk]);
+        power += mag2(full[kk]);
+    }
+    check(error <= tolerance*tolerance*power, "real size %lld error %g", size, sqrt(error/power));
+
+    error = power = 0;
+    for (int64 ii = 0; ii<size; ii++) {
+        error += sqr(back[ii]/size - src[ii]);
+        power += sqr(src[ii]);
+    }
+    check(error <= tolerance*tolerance*power, "real inverse %lld error %g", size, sqrt(error/power));
+}
+
+int main() {
+    check(&fftplan<float>(1000) == &fftplan<float>(1000), "cached plan");
+    check(&fftplan<float>(1000) != &fftplan<float>(1000, true), "cached inverse");
+    check(&fftplan<float>(1000) != &fftplan<float>(1024), "cached size");
+
+    threadpool pool(3);
+    batchcheck<float>(256, 10, pool);
+    batchcheck<double>(96, 7, pool);
+    batchcheck<float>(5*67, 2, pool);
+
+    primecheck<float>(67, false, 1e-5);
+    primecheck<float>(1031, true, 1e-5);
+    primecheck<double>(2*3*127, false, 1e-12);
+    primecheck<double>(67*71, true, 1e-12);
+    realcheck<float>(2, 1e-5);
+    realcheck<float>(4096, 1e-5);
+    realcheck<float>(1000, 1e-5);
+    realcheck<double>(30, 1e-13);
+    realcheck<double>(65536, 1e-13);
+
+    for (int64 size = 1; size <= 65536; size *= 2) {
+        compare<float>(size, false, 1e-5);
+        compare<float>(size, true, 1e-5);
+        compare<double>(size, false, 1e-13);
+        compare<double>(size, true, 1e-13);
+    }
+    compare<float>(1000, false, 1e-5);
+    compare<double>(96, true, 1e-13);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <xm/mednoise.h>
+#include <sys/time.h>
+#include <xm/random.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// introselect against a full sort, with lots of duplicates
+static void select(int64 len, int64 values) {
+    vector<int> data(len), sorted(len);
+    for (int64 ii = 0; ii<len; ii++) {
+        data[ii] = sorted[ii] = rand()%values;
+    }
+    introsort(sorted.data(), len);
+    for (int64 pos = 0; pos<len; pos += 1 + len/17) {
+        vector<int> copy = data;
+        introselect(copy.data(), len, pos);
+        check(copy[pos] == sorted[pos], "introselect %lld of %lld", pos, len);
+        for (int64 ii = 0; ii<len; ii++) {
+            check(ii < pos ? copy[ii] <= copy[pos] : copy[ii] >= copy[pos], "partition");
+        }
+    }
+}
+
+static double decibels(double ratio) {
+    return fabs(10*log10(ratio));
+}
+
+int main() {
+    select(1, 1);
+    select(9, 3);
+    select(1000, 2);
+    select(1001, 1000000);
+    select(20000, 50);
+
+    // noise of power 4 with a strong tone in a hundredth of it
+    const int64 len = 200000;
+    vector<cfloat> data(len);
+    longprng prng(12345);
+    for (int64 ii = 0; ii<len; ii++) {
+        data[ii] = cfloat(prng.normal()*1.41421356, prng.normal()*1.41421356);
+        if (ii%100 == 0) data[ii] += cfloat(1000, 0);
+    }
+
+    const double exact = mednoise(data.data(), len, true);
+    const double binned = mednoise(data.data(), len);
+    check(decibels(exact/binned) < .01, "binned %lf vs exact %lf", binned, exact);
+    check(decibels(exact/4) < .3, "exact %lf vs 4", exact);
+
+    // the window slides over the last piece, one uneven update at a time
+    const int64 window = 30001;
+    runmednoise running(window);
+    for (int64 off = 0; off<len; off += 7777) {
+        running.update(data.data() + off, min((int64)7777, len - off));
+    }
+    check(running.size() == window, "window %lld", running.size());
+    const double last = mednoise(data.data() + len - window, window, true);
+    check(decibels(last/running.estimate()) < .05, "running %lf vs %lf", running.estimate(), last);
+
+    // NaN with and without the sign bit, and inf, are just more outliers
+    for (int64 ii = 0; ii<len; ii += 1000) {
+        data[ii] = cfloat(ii%3000 ? -NAN : NAN, 0);
+        data[ii + 1] = cfloat(-HUGE_VALF, 0);
+    }
+    check(decibels(mednoise(data.data(), len, true)/4) < .3, "exact with NaN");
+    check(decibels(mednoise(data.data(), len)/4) < .3, "binned with NaN");
+    runmednoise spoiled(window);
+    spoiled.update(data.data(), len);
+    check(decibels(spoiled.estimate()/4) < .3, "running with NaN");
+
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include <xm/parallel.h>
+
+struct squares {
+    long long* data;
+    void operator ()(long long index) {
+        data[index] = index*index;
+    }
+};
+
+int main() {
+    using namespace xm;
+
+    long long data[1000];
+    squares func = { data };
+    threadpool pool(4);
+    pool.parfor(1000, func);
+    for (int64 ii = 0; ii<1000; ii++) {
+        check(data[ii] == ii*ii, "sanity");
+    }
+
+    return 0;
+}
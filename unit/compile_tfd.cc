@@ -0,0 +1,55 @@
+#include <xm/tfd.h>
+#include <stdlib.h>
+
+using namespace xm;
+
+// Against tuning each input sample by exp(j*2*pi*dfreq*n) and then
+// applying the lowpass directly, in double
+static void directcheck(
+    double dfreq, int64 decim, int window, double dwidth, int64 taps,
+    int64 off, int64 len, double tolerance
+) {
+    tfd engine(dfreq, decim, window, dwidth, taps);
+    const int64 margin = engine.margin();
+    const int64 first = off*decim - margin;
+    vector<cfloat> src(engine.needed(len)), dst(len);
+    for (int64 ii = 0; ii<src.size(); ii++) {
+        src[ii].re = (float)(rand()/(double)RAND_MAX - .5);
+        src[ii].im = (float)(rand()/(double)RAND_MAX - .5);
+    }
+    engine.apply(dst.data(), off, len, src.data());
+
+    // the same odd count lowpass, normalized for unity gain
+    const int64 count = 2*margin + 1;
+    vector<double> lowpass(count);
+    double sum = 0;
+    for (int64 kk = 0; kk<count; kk++) {
+        lowpass[kk] = firwin(window, kk - margin, count)*sinc((kk - margin)*dwidth);
+        sum += lowpass[kk];
+    }
+
+    double error = 0, power = 0;
+    for (int64 mm = 0; mm<len; mm++) {
+        cdouble acc(0, 0);
+        for (int64 kk = 0; kk<count; kk++) {
+            const int64 nn = (off + mm)*decim - margin + kk;
+            const double phase = 2*M_PI*fmod(dfreq*nn, 1.0);
+            const cfloat xx = src[nn - first];
+            acc += lowpass[kk]/sum*cdouble(xx.re, xx.im)*cdouble(cos(phase), sin(phase));
+        }
+        error += mag2(cdouble(dst[mm].re, dst[mm].im) - acc);
+        power += mag2(acc);
+    }
+    check(
+        error <= tolerance*tolerance*power, "dfreq %g decim %lld taps %lld error %g",
+        dfreq, decim, taps, sqrt(error/power)
+    );
+}
+
+int main() {
+    directcheck(.1234, 7, 2, .1, 61, 1000, 100, 1e-5);
+    directcheck(-.31, 1, 1, .4, 20, 0, 300, 1e-5);
+    directcheck(.05, 16, 3, .05, 257, 123457, 50, 1e-5);
+    directcheck(0, 3, 2, .3, 1, 5, 10, 1e-6);
+    return 0;
+}
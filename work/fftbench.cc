@@ -0,0 +1,95 @@
+#include "xmtools.h"
+using namespace xm;
+
+//
+// Times the recursive KISS FFT against the iterative SIMD path for
+// power of 2 sizes, and reports the usual 5*N*log2(N) MFlops.
+//
+template<class type>
+static void bench(int64 size) {
+    kissfft<type> fft(size);
+    vector<complex<type> > src(size), dst(size);
+    for (int64 ii = 0; ii<size; ii++) {
+        src[ii].re = (type)(ii%7 - 3);
+        src[ii].im = (type)(ii%5 - 2);
+    }
+
+    // enough repetitions for about 100M flops per measurement
+    const double flops = 5.0*size*log2((double)size);
+    const int64 reps = max(1, (int64)(1e8/flops));
+
+    double start = stopwatch();
+    for (int64 rr = 0; rr<reps; rr++) fft.exec_generic(dst.data(), src.data());
+    double generic = stopwatch() - start;
+
+    start = stopwatch();
+    for (int64 rr = 0; rr<reps; rr++) fft.exec(dst.data(), src.data());
+    double fast = stopwatch() - start;
+
+    printf(
+        "%-6s %8lld  %9.1f  %9.1f  %5.2fx\n",
+        sizeof(type) == 4 ? "float" : "double", size,
+        reps*flops/generic*1e-6, reps*flops/fast*1e-6, generic/fast
+    );
+}
+
+// real input through a complex FFT versus realfft
+template<class type>
+static void realbench(int64 size) {
+    kissfft<type> fft(size);
+    realfft<type> rfft(size);
+    vector<type> real(size);
+    vector<complex<type> > src(size), dst(size);
+    for (int64 ii = 0; ii<size; ii++) {
+        real[ii] = (type)(ii%7 - 3);
+        src[ii] = complex<type>(real[ii], 0);
+    }
+
+    const double flops = 5.0*size*log2((double)size);
+    const int64 reps = max(1, (int64)(1e8/flops));
+
+    double start = stopwatch();
+    for (int64 rr = 0; rr<reps; rr++) fft.exec(dst.data(), src.data());
+    double cplx = stopwatch() - start;
+
+    start = stopwatch();
+    for (int64 rr = 0; rr<reps; rr++) rfft.exec(dst.data(), real.data());
+    double half = stopwatch() - start;
+
+    printf(
+        "%-6s %8lld  %9.3f  %9.3f  %5.2fx\n",
+        sizeof(type) == 4 ? "float" : "double", size,
+        cplx/reps*1e3, half/reps*1e3, cplx/half
+    );
+}
+
+// many same size transforms split across threads
+static void batchbench(int64 size, int64 count, int64 threads) {
+    threadpool pool(threads);
+    kissfft<float> fft(size);
+    vector<cfloat> src(size*count, cfloat(1, 2)), dst(size*count);
+
+    const double flops = 5.0*size*log2((double)size)*count;
+    const int64 reps = max(1, (int64)(1e9/flops));
+    double start = stopwatch();
+    for (int64 rr = 0; rr<reps; rr++) {
+        fft.batch(dst.data(), src.data(), count, 1, size, pool);
+    }
+    double elapsed = stopwatch() - start;
+    printf("%8lld x %-6lld %3lld threads  %9.1f\n", size, count, threads, reps*flops/elapsed*1e-6);
+}
+
+int main() {
+    printf("%-6s %8s  %9s  %9s  %6s\n", "type", "size", "generic", "simd", "speedup");
+    for (int64 size = 64; size <= 1048576; size *= 2) bench<float>(size);
+    for (int64 size = 64; size <= 1048576; size *= 2) bench<double>(size);
+
+    printf("\n%-6s %8s  %9s  %9s  %6s\n", "type", "size", "cplx ms", "real ms", "speedup");
+    for (int64 size = 64; size <= 1048576; size *= 4) realbench<float>(size);
+    for (int64 size = 64; size <= 1048576; size *= 4) realbench<double>(size);
+
+    printf("\n%-26s  %9s\n", "batch", "MFlops");
+    for (int64 threads = 1; threads <= 8; threads *= 2) batchbench(1024, 4096, threads);
+    for (int64 threads = 1; threads <= 8; threads *= 2) batchbench(65536, 64, threads);
+    return 0;
+}
@@ -52,7 +52,7 @@ static double fircost(double* args) {
     const int64 size = 10000;
     vector<cfloat> timedata(size, 0);
     vector<cfloat> freqdata(size);
-    kissfft<float> fft(size);
+    const kissfft<float>& fft = fftplan<float>(size);
 
     const int64 taps = 4*muls + 1;
 
@@ -138,7 +138,7 @@ static double tapcost(double* args) {
 
     vector<cfloat> timedata(size, 0);
     vector<cfloat> freqdata(size);
-    kissfft<float> fft(size);
+    const kissfft<float>& fft = fftplan<float>(size);
     
     timedata[taps/2] = 1.0;
     for (int64 ii = 0; ii<muls; ii++) {
@@ -335,7 +335,7 @@ int main() {
     const int64 size = 8192;
     vec<cfloat> timedata(size);
     vec<cfloat> freqdata(size);
-    kissfft<float> fft(size);
+    const kissfft<float>& fft = fftplan<float>(size);
     zero(timedata);
 
     //const int64 window = 2, muls = 12;